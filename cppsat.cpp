@@ -1,20 +1,769 @@
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <string>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <minisat/core/Solver.h>
+#include <minisat/simp/SimpSolver.h>
+#ifdef CPPSAT_IPASIR
+extern "C" {
+#include <ipasir.h>
+}
+#endif
 #include "cppsat.hpp"
 
 namespace {
-  static Minisat::Solver solver;
+  // Structural hashing: every gate is keyed by its type and its normalized
+  // input literals, so that building the same gate twice yields the same
+  // output literal instead of a fresh variable and fresh clauses.
+  // Literals are Minisat integers, i.e. negation flips the lowest bit.
+  enum class GateType { And, Xor, Ite };
+
+  struct GateKey {
+    GateType          type;
+    std::vector <int> inputs;
+
+    bool operator== (const GateKey& other) const {
+      return this->type == other.type && this->inputs == other.inputs;
+    }
+  };
+
+  struct GateKeyHash {
+    size_t operator() (const GateKey& key) const {
+      size_t h = std::hash <int> () (int (key.type));
+      for (int i : key.inputs) {
+        h ^= std::hash <int> () (i) + 0x9e3779b9 + (h << 6) + (h >> 2);
+      }
+      return h;
+    }
+  };
+
+  typedef std::unordered_map <GateKey, cppsat::Bit, GateKeyHash> GateCache;
+
+  // The definition of a gate's output.  Its clauses are emitted per
+  // direction: `positive` are the clauses with a negative output literal,
+  // which are needed as soon as the output is used positively, and
+  // `negative` the ones with a positive output literal.
+  struct Gate {
+    GateType          type;
+    std::vector <int> inputs;
+    int               output;
+    bool              positive;
+    bool              negative;
+  };
+
+  int toDimacs (int literal) {
+    return (literal & 1) ? -((literal >> 1) + 1) : (literal >> 1) + 1;
+  }
+
+  typedef cppsat::Result Result;
+
+  // The interface of a SAT solver backend.  Literals are the integers of
+  // Bit::literal, i.e. 2v and 2v+1 are the literals of variable v.
+  class Solver {
+    public:
+      virtual ~Solver () {}
+
+      virtual int    newVar          () = 0;
+      virtual int    numVars         () const = 0;
+      virtual void   addClause       (const int*, size_t) = 0;
+
+      // Adds the length-prefixed clauses of an arena
+      virtual void addClauses (const int* arena, size_t size) {
+        for (size_t i = 0; i < size; i += arena[i] + 1) {
+          this->addClause (&arena[i + 1], arena[i]);
+        }
+      }
+      // Backends without search counters ignore the budget
+      virtual Result solve           (const std::vector <int>&, const cppsat::Budget&) = 0;
+
+      // The value of a variable in the model of the last satisfiable call
+      virtual bool   modelValue      (int) const = 0;
+
+      // Whether the last unsatisfiable call depends on an assumption
+      virtual bool   failed          (int) const = 0;
+
+      // interrupt may be called from any thread and makes a running call
+      // return Unknown
+      virtual void   interrupt       () = 0;
+      virtual void   clearInterrupt  () = 0;
+
+      // Gives the i-th solver of a portfolio its own search strategy.  The
+      // first one keeps the backend's defaults.
+      virtual void   diversify       (unsigned int) {}
+
+      // Preprocesses the formula, which may eliminate any variable but the
+      // frozen ones.  Eliminated variables still have model values.
+      virtual void   simplify        (const std::vector <int>&) {}
+      virtual bool   isEliminated    (int) const { return false; }
+
+      virtual void   printStatistics (std::ostream&) const = 0;
+
+      // Fills in the search counters of the statistics that it keeps
+      virtual void   counters        (cppsat::Statistics&) const {}
+  };
+
+  // Minisat's SimpSolver, whose variable elimination and subsumption only run
+  // on simplify.  Without simplification they are turned off right away, so
+  // that no occurrence lists are kept.
+  class MinisatSolver : public Solver {
+    public:
+      explicit MinisatSolver (bool simplification) {
+        if (simplification == false) {
+          this->solver.eliminate (true);
+        }
+      }
+
+      int newVar () override {
+        return this->solver.newVar ();
+      }
+
+      int numVars () const override {
+        return this->solver.nVars ();
+      }
+
+      void addClause (const int* literals, size_t size) override {
+        this->literals.clear ();
+        for (size_t i = 0; i < size; i++) {
+          this->literals.push (Minisat::toLit (literals[i]));
+        }
+        this->solver.addClause (this->literals);
+      }
+
+      Result solve (const std::vector <int>& assumptions, const cppsat::Budget& budget) override {
+        this->literals.clear ();
+        for (int literal : assumptions) {
+          this->literals.push (Minisat::toLit (literal));
+        }
+        this->solver.budgetOff ();
+        if (budget.conflicts >= 0) {
+          this->solver.setConfBudget (budget.conflicts);
+        }
+        if (budget.propagations >= 0) {
+          this->solver.setPropBudget (budget.propagations);
+        }
+        const Minisat::lbool r = this->solver.solveLimited (this->literals, false);
+
+        this->conflict.clear ();
+        if (r == Minisat::l_True) {
+          return Result::Sat;
+        }
+        else if (r == Minisat::l_False) {
+          for (int i = 0; i < this->solver.conflict.size (); i++) {
+            this->conflict.push_back (Minisat::toInt (this->solver.conflict[i]));
+          }
+          std::sort (this->conflict.begin (), this->conflict.end ());
+          return Result::Unsat;
+        }
+        else {
+          return Result::Unknown;
+        }
+      }
+
+      bool modelValue (int var) const override {
+        return this->solver.modelValue (Minisat::Var (var)) == Minisat::l_True;
+      }
+
+      // Minisat's conflict holds the negations of the failed assumptions
+      bool failed (int literal) const override {
+        return std::binary_search (this->conflict.begin (), this->conflict.end (), literal ^ 1);
+      }
+
+      void interrupt () override {
+        this->solver.interrupt ();
+      }
+
+      void clearInterrupt () override {
+        this->solver.clearInterrupt ();
+      }
+
+      void diversify (unsigned int i) override {
+        if (i == 0) {
+          return;
+        }
+        this->solver.random_seed     = 91648253 + 7919 * i;
+        this->solver.random_var_freq = i % 2 == 1 ? 0.02 : 0.0;
+        this->solver.luby_restart    = i % 3 != 2;
+        this->solver.restart_first   = 100 * (1 + i % 4);
+        this->solver.var_decay       = 0.95 - 0.01 * (i % 5);
+        this->solver.phase_saving    = i % 4 == 3 ? 0 : 2;
+        this->solver.rnd_pol         = i % 8 == 5;
+      }
+
+      void simplify (const std::vector <int>& frozen) override {
+        for (int var : frozen) {
+          this->solver.setFrozen (Minisat::Var (var), true);
+        }
+        this->solver.eliminate (false);
+      }
+
+      bool isEliminated (int var) const override {
+        return this->solver.isEliminated (Minisat::Var (var));
+      }
+
+      void counters (cppsat::Statistics& statistics) const override {
+        statistics.conflicts    = this->solver.conflicts;
+        statistics.decisions    = this->solver.decisions;
+        statistics.propagations = this->solver.propagations;
+        statistics.restarts     = this->solver.starts;
+        statistics.learnts      = this->solver.nLearnts ();
+      }
+
+      void printStatistics (std::ostream& os) const override {
+        os << "#variables: "  << this->solver.nVars ()
+           << ", #clauses: "  << this->solver.nClauses ()
+           << ", #literals: " << this->solver.clauses_literals
+           << std::endl;
+      }
+
+    private:
+      Minisat::SimpSolver         solver;
+      Minisat::vec <Minisat::Lit> literals;
+      std::vector <int>           conflict;
+  };
+
+#ifdef CPPSAT_IPASIR
+  // Any solver that implements the IPASIR interface, linked in place of
+  // ipasir.h's functions.  IPASIR solvers create variables on their first
+  // use, so newVar only counts them.
+  class IpasirSolver : public Solver {
+    public:
+      IpasirSolver ()
+        : solver      (ipasir_init ())
+        , vars        (0)
+        , clauses     (0)
+        , literals    (0)
+        , interrupted (false)
+      {
+        ipasir_set_terminate (this->solver, this, [] (void* self) {
+          return int (static_cast <IpasirSolver*> (self)->interrupted.load ());
+        });
+      }
+
+      ~IpasirSolver () {
+        ipasir_release (this->solver);
+      }
+
+      int newVar () override {
+        return this->vars++;
+      }
+
+      int numVars () const override {
+        return this->vars;
+      }
+
+      void addClause (const int* literals, size_t size) override {
+        for (size_t i = 0; i < size; i++) {
+          ipasir_add (this->solver, toDimacs (literals[i]));
+        }
+        ipasir_add (this->solver, 0);
+        this->clauses++;
+        this->literals += size;
+      }
+
+      Result solve (const std::vector <int>& assumptions, const cppsat::Budget&) override {
+        for (int literal : assumptions) {
+          ipasir_assume (this->solver, toDimacs (literal));
+        }
+        switch (ipasir_solve (this->solver)) {
+          case 10: return Result::Sat;
+          case 20: return Result::Unsat;
+          default: return Result::Unknown;
+        }
+      }
+
+      bool modelValue (int var) const override {
+        return ipasir_val (this->solver, var + 1) > 0;
+      }
+
+      bool failed (int literal) const override {
+        return ipasir_failed (this->solver, toDimacs (literal)) != 0;
+      }
+
+      void interrupt () override {
+        this->interrupted = true;
+      }
+
+      void clearInterrupt () override {
+        this->interrupted = false;
+      }
+
+      void printStatistics (std::ostream& os) const override {
+        os << "#variables: "  << this->vars
+           << ", #clauses: "  << this->clauses
+           << ", #literals: " << this->literals
+           << " (" << ipasir_signature () << ")"
+           << std::endl;
+      }
+
+    private:
+      void*               solver;
+      int                 vars;
+      size_t              clauses;
+      size_t              literals;
+      std::atomic <bool>  interrupted;
+  };
+#endif
+
+  std::unique_ptr <Solver> newSolver (cppsat::Backend backend) {
+    switch (backend) {
+      case cppsat::Backend::Minisat:
+        return std::unique_ptr <Solver> (new MinisatSolver (false));
+      case cppsat::Backend::MinisatSimp:
+        return std::unique_ptr <Solver> (new MinisatSolver (true));
+      case cppsat::Backend::Ipasir:
+#ifdef CPPSAT_IPASIR
+        return std::unique_ptr <Solver> (new IpasirSolver);
+#else
+        std::cerr << "cppsat: built without an IPASIR solver (define CPPSAT_IPASIR)" << std::endl;
+        break;
+#endif
+    }
+    std::abort ();
+  }
+}
+
+struct cppsat::Context::State {
+  cppsat::Backend           backend;
+  std::unique_ptr <Solver>  solver;
+  std::vector <char>        model;
+  cppsat::Encoding          encoding   = cppsat::Encoding::Tseitin;
+  GateCache                 gates;
+  std::vector <Gate>        definitions;
+  std::vector <int>         definitionOf;
+  std::vector <char>        evaluated;
+  std::vector <cppsat::Bit> scopes;
+  std::vector <cppsat::Bit> core;
+  std::vector <int>         clauses;
+  bool                      logging    = false;
+
+  std::ostream*             dimacs        = nullptr;
+  std::streampos            dimacsHeader  = -1;
+  size_t                    dimacsClauses = 0;
+  bool                      dimacsStream  = false;
+  std::vector <std::pair <std::string, cppsat::Bits>> names;
+
+  std::mutex                runningMutex;
+  std::vector <Solver*>     running;
+  bool                      interrupted = false;
+
+  cppsat::Statistics        statistics;
+  bool                      instrumented   = false;
+  size_t                    operationDepth = 0;
+};
+
+namespace {
+  // The context that free functions and Bit/Bits operations of this thread
+  // act upon, or nullptr for the default context
+  thread_local cppsat::Context* currentContext = nullptr;
+
+  cppsat::Context::State& state () {
+    return cppsat::Context::current ().state ();
+  }
+
+  double now () {
+    const auto time = std::chrono::steady_clock::now ().time_since_epoch ();
+    return std::chrono::duration <double> (time).count ();
+  }
+
+  // Adds the time of its lifetime to `total`
+  class Stopwatch {
+    public:
+      explicit Stopwatch (double& total) : total (total), start (now ()) {}
+              ~Stopwatch () { this->total += now () - this->start; }
+
+    private:
+      double&      total;
+      const double start;
+  };
+
+  // Makes solvers reachable by Context::interrupt while they run.  An
+  // interrupt that came before they were registered stops them at once.
+  class Running {
+    public:
+      Running (cppsat::Context::State& s, const std::vector <Solver*>& solvers)
+        : s (s)
+      {
+        std::lock_guard <std::mutex> lock (s.runningMutex);
+        s.running = solvers;
+        if (s.interrupted) {
+          for (Solver* solver : solvers) {
+            solver->interrupt ();
+          }
+        }
+      }
+
+      ~Running () {
+        std::lock_guard <std::mutex> lock (this->s.runningMutex);
+        for (Solver* solver : this->s.running) {
+          solver->clearInterrupt ();
+        }
+        this->s.running.clear ();
+        this->s.interrupted = false;
+      }
+
+    private:
+      cppsat::Context::State& s;
+  };
+
+  // Interrupts a context once a number of seconds has passed, unless it is
+  // destroyed before.  Negative numbers of seconds never pass.
+  class Watchdog {
+    public:
+      Watchdog (cppsat::Context& context, double seconds)
+        : done (false)
+      {
+        if (seconds >= 0) {
+          this->thread = std::thread ([this, &context, seconds] () {
+            std::unique_lock <std::mutex> lock (this->mutex);
+            if (this->finished.wait_for ( lock, std::chrono::duration <double> (seconds)
+                                        , [this] () { return this->done; } ) == false)
+            {
+              context.interrupt ();
+            }
+          });
+        }
+      }
+
+      ~Watchdog () {
+        {
+          std::lock_guard <std::mutex> lock (this->mutex);
+          this->done = true;
+        }
+        this->finished.notify_one ();
+        if (this->thread.joinable ()) {
+          this->thread.join ();
+        }
+      }
+
+    private:
+      std::mutex              mutex;
+      std::condition_variable finished;
+      bool                    done;
+      std::thread             thread;
+  };
+
+  // Measures an operation if the context is instrumented and no enclosing
+  // operation is measured already
+  class OperationScope {
+    public:
+      explicit OperationScope (cppsat::Operation operation)
+        : s         (state ())
+        , operation (operation)
+        , measured  (s.instrumented && s.operationDepth == 0)
+        , variables (0)
+        , clauses   (0)
+        , start     (0)
+      {
+        if (this->measured) {
+          this->variables = this->s.solver->numVars ();
+          this->clauses   = this->s.statistics.clauses;
+          this->start     = now ();
+        }
+        this->s.operationDepth++;
+      }
+
+      ~OperationScope () {
+        this->s.operationDepth--;
+        if (this->measured) {
+          const double    seconds = now () - this->start;
+          cppsat::Counts& counts  = this->s.statistics.operations[this->operation];
+
+          counts.variables += this->s.solver->numVars () - this->variables;
+          counts.clauses   += this->s.statistics.clauses - this->clauses;
+          counts.seconds   += seconds;
+          this->s.statistics.encodingSeconds += seconds;
+        }
+      }
+
+    private:
+      cppsat::Context::State& s;
+      cppsat::Operation       operation;
+      bool                    measured;
+      size_t                  variables;
+      size_t                  clauses;
+      double                  start;
+  };
+
+  void printDimacsClause (cppsat::Context::State& s, const int* literals, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      *s.dimacs << toDimacs (literals[i]) << ' ';
+    }
+    *s.dimacs << "0\n";
+    s.dimacsClauses++;
+  }
+
+  // The final counts in the header are only known when the output is
+  // closed, so they are written with a fixed width and patched in place
+  void printDimacsHeader (cppsat::Context::State& s) {
+    char header[64];
+    std::snprintf ( header, sizeof (header), "p cnf %10d %10zu\n"
+                  , s.solver->numVars (), s.dimacsClauses );
+    *s.dimacs << header;
+  }
+
+  // A snapshot is a flat array of ints: a header, the clause log as it is,
+  // the gate definitions as (type, directions, output, #inputs, inputs) and
+  // the names as (#characters, #bits, characters, bits).  Constant bits of
+  // names are stored as negative numbers.
+  const int snapshotMagic   = 0x63707331;
+  const int snapshotFalse   = -1;
+  const int snapshotTrue    = -2;
+
+  struct SnapshotHeader {
+    int magic;
+    int numVars;
+    int clauses;
+    int definitions;
+    int names;
+  };
+
+  // If logClauses was called, every emitted clause is also recorded as a
+  // length-prefixed run of literals, such that further solvers can be
+  // loaded with the same formula
+  void emitClause (const int* literals, size_t size) {
+    cppsat::Context::State& s = state ();
+    if (s.logging) {
+      s.clauses.push_back (int (size));
+      s.clauses.insert (s.clauses.end (), literals, literals + size);
+    }
+    s.solver->addClause (literals, size);
+    s.statistics.clauses  += 1;
+    s.statistics.literals += size;
+
+    if (s.dimacsStream) {
+      printDimacsClause (s, literals, size);
+    }
+  }
+
+  void emitClause (int a, int b) {
+    const int literals[] = { a, b };
+    emitClause (literals, 2);
+  }
+
+  void emitClause (int a, int b, int c) {
+    const int literals[] = { a, b, c };
+    emitClause (literals, 3);
+  }
 
-  Minisat::Lit toMinisatLit (const cppsat::Bit& bit) {
-    assert (bit.isConstant () == false);
-    return Minisat::toLit (bit.literal ());
+  // Emits all clauses of a length-prefixed arena at once
+  void emitClauses (const int* arena, size_t size) {
+    cppsat::Context::State& s = state ();
+    if (s.logging) {
+      s.clauses.insert (s.clauses.end (), arena, arena + size);
+    }
+    s.solver->addClauses (arena, size);
+
+    for (size_t i = 0; i < size; i += arena[i] + 1) {
+      s.statistics.clauses  += 1;
+      s.statistics.literals += arena[i];
+
+      if (s.dimacsStream) {
+        printDimacsClause (s, &arena[i + 1], arena[i]);
+      }
+    }
+  }
+
+  void loadClauses (Solver& solver, const std::vector <int>& clauses, int numVars) {
+    while (solver.numVars () < numVars) {
+      solver.newVar ();
+    }
+    solver.addClauses (clauses.data (), clauses.size ());
+  }
+
+  // Copies the model of a solver's last satisfiable call into the context
+  void storeModel (const Solver& solver) {
+    cppsat::Context::State& s = state ();
+
+    s.model.resize (solver.numVars ());
+    for (size_t var = 0; var < s.model.size (); var++) {
+      s.model[var] = solver.modelValue (int (var));
+    }
+  }
+
+  // Emits the clauses of all gate directions that are needed for the given
+  // literals to occur in the formula, and transitively the directions that
+  // the inputs of these clauses need.
+  void require (const int* required, size_t size) {
+    cppsat::Context::State& s = state ();
+
+    // the worklist and the buffer for long clauses are kept between calls
+    thread_local std::vector <int> literals;
+    thread_local std::vector <int> clause;
+    literals.assign (required, required + size);
+
+    while (literals.empty () == false) {
+      const int    literal = literals.back ();
+      const size_t var     = literal >> 1;
+      literals.pop_back ();
+
+      if (var >= s.definitionOf.size () || s.definitionOf[var] < 0) {
+        continue;
+      }
+
+      Gate&      gate     = s.definitions[s.definitionOf[var]];
+      const bool positive = (literal & 1) == 0;
+      bool&      emitted  = positive ? gate.positive : gate.negative;
+      const int  r        = positive ? gate.output ^ 1 : gate.output;
+
+      if (emitted) {
+        continue;
+      }
+      emitted = true;
+
+      // the literals of every emitted clause but `r` are required in turn
+      switch (gate.type) {
+        case GateType::And:
+          if (positive) {
+            for (int x : gate.inputs) {
+              emitClause (r, x);
+              literals.push_back (x);
+            }
+          }
+          else {
+            clause.assign (1, r);
+            for (int x : gate.inputs) {
+              clause.push_back (x ^ 1);
+              literals.push_back (x ^ 1);
+            }
+            emitClause (clause.data (), clause.size ());
+          }
+          break;
+        case GateType::Xor: {
+          const int a = gate.inputs[0];
+          const int b = positive ? gate.inputs[1] : gate.inputs[1] ^ 1;
+
+          emitClause (r, a    , b    );
+          emitClause (r, a ^ 1, b ^ 1);
+          literals.insert (literals.end (), { a, b, a ^ 1, b ^ 1 });
+          break;
+        }
+        case GateType::Ite: {
+          const int c = gate.inputs[0];
+          const int t = positive ? gate.inputs[1] : gate.inputs[1] ^ 1;
+          const int f = positive ? gate.inputs[2] : gate.inputs[2] ^ 1;
+
+          emitClause (r, c ^ 1, t);
+          emitClause (r, c    , f);
+          literals.insert (literals.end (), { c ^ 1, t, c, f });
+          break;
+        }
+      }
+    }
+  }
+
+  // Registers the definition of a new gate.  In Tseitin mode both directions
+  // are emitted right away, otherwise they are emitted once the output is
+  // used in a clause or as an assumption.
+  void defineGate (GateType type, const std::vector <int>& inputs, const cppsat::Bit& output) {
+    cppsat::Context::State& s   = state ();
+    const size_t            var = output.literal () >> 1;
+
+    if (s.definitionOf.size () <= var) {
+      s.definitionOf.resize (var + 1, -1);
+    }
+    s.definitionOf[var] = s.definitions.size ();
+    s.definitions.push_back ({ type, inputs, output.literal (), false, false });
+
+    if (s.encoding == cppsat::Encoding::Tseitin) {
+      const int both[] = { output.literal (), output.literal () ^ 1 };
+      require (both, 2);
+    }
+  }
+
+  // Evaluates a literal in the current model.  Outputs of gates that lack a
+  // direction may have arbitrary model values, so they are evaluated from
+  // their inputs.
+  bool evaluate (int root) {
+    cppsat::Context::State& s = state ();
+
+    // 0: not evaluated, 1: false, 2: true
+    s.evaluated.resize (s.solver->numVars (), 0);
+
+    std::vector <int> stack (1, root >> 1);
+    while (stack.empty () == false) {
+      const size_t var = stack.back ();
+
+      if (s.evaluated[var] != 0) {
+        stack.pop_back ();
+        continue;
+      }
+
+      const bool isPartial = var < s.definitionOf.size () && s.definitionOf[var] >= 0
+                          && ( s.definitions[s.definitionOf[var]].positive == false
+                            || s.definitions[s.definitionOf[var]].negative == false );
+      if (isPartial == false) {
+        s.evaluated[var] = s.model[var] ? 2 : 1;
+        stack.pop_back ();
+        continue;
+      }
+
+      const Gate& gate     = s.definitions[s.definitionOf[var]];
+      bool        complete = true;
+      for (int input : gate.inputs) {
+        if (s.evaluated[input >> 1] == 0) {
+          stack.push_back (input >> 1);
+          complete = false;
+        }
+      }
+      if (complete) {
+        auto value = [&s] (int literal) {
+          return (s.evaluated[literal >> 1] == 2) != bool (literal & 1);
+        };
+        bool result = false;
+        switch (gate.type) {
+          case GateType::And:
+            result = std::all_of (gate.inputs.begin (), gate.inputs.end (), value);
+            break;
+          case GateType::Xor:
+            result = value (gate.inputs[0]) != value (gate.inputs[1]);
+            break;
+          case GateType::Ite:
+            result = value (gate.inputs[0]) ? value (gate.inputs[1])
+                                            : value (gate.inputs[2]);
+            break;
+        }
+        s.evaluated[var] = result ? 2 : 1;
+        stack.pop_back ();
+      }
+    }
+    return (s.evaluated[root >> 1] == 2) != bool (root & 1);
   }
 
-  Minisat::Var toMinisatVar (const cppsat::Bit& bit) {
-    assert (bit.isConstant () == false);
-    return Minisat::var (toMinisatLit (bit));
+  // Adds a clause to the solver, which is guarded by the innermost open
+  // scope if `scoped` is set.  Only constants are folded here: the model of
+  // an earlier solve must not turn a clause into a different one.
+  void addClause (const cppsat::Bit* bits, size_t size, bool scoped) {
+    const std::vector <cppsat::Bit>& scopes = state ().scopes;
+    thread_local std::vector <int>   literals;
+    literals.clear ();
+
+    for (size_t i = 0; i < size; i++) {
+      if (bits[i].isConstant () == false) {
+        literals.push_back (bits[i].literal ());
+      }
+      else if (bits[i].value ()) {
+        return;
+      }
+    }
+    if (scoped && scopes.empty () == false) {
+      literals.push_back (scopes.back ().negate ().literal ());
+    }
+    require (literals.data (), literals.size ());
+    emitClause (literals.data (), literals.size ());
   }
 
   template <typename T>
@@ -33,21 +782,12 @@ namespace {
 
   std::vector <bool> toBinary (size_t s, unsigned int i) {
     std::vector <bool> bits;
+    bits.reserve (s);
 
-    std::function <void (unsigned int)> go = [s, &bits, &go] (unsigned int j) {
+    for (; i > 0; i /= 2) {
       assert (bits.size () < s);
-      if (j < 2) {
-        bits.push_back (bool (j));
-      }
-      else {
-        const std::div_t d = std::div (j, 2);
-
-        bits.push_back (bool (d.rem));
-        go (d.quot);
-      }
-    };
-    go ((unsigned int) std::abs (i));
-
+      bits.push_back (bool (i % 2));
+    }
     while (bits.size () < s) {
       bits.push_back (false);
     }
@@ -63,530 +803,2610 @@ namespace {
     return result;
   }
 
-  void equalizeLength (cppsat::Bits& a, cppsat::Bits& b) {
-    const size_t max = std::max (a.size (), b.size ());
+  typedef std::pair <cppsat::Bit, cppsat::Bit> BitPair;
+  typedef std::vector <cppsat::Bit>            BitVector;
 
-    while (a.size () < max) {
-      a.add (cppsat::Bit (false));
-    }
-    while (b.size () < max) {
-      b.add (cppsat::Bit (false));
+  // i-th bit of `bits`, or false beyond its width
+  cppsat::Bit bitAt (const cppsat::Bits& bits, size_t i) {
+    return i < bits.size () ? bits[i] : cppsat::Bit (false);
+  }
+
+  bool isConstant (const cppsat::Bits& bits) {
+    return std::all_of ( bits.begin (), bits.end ()
+                       , [] (const cppsat::Bit& b) { return b.isConstant (); } );
+  }
+
+  // Ripple-carry adder over the width of the wider operand.  Subtracts if
+  // `subtract` is set, i.e. adds the complement of `b`, in which case the
+  // carry is an inverted borrow.
+  std::pair <cppsat::Bits, cppsat::Bit> rippleCarry ( const cppsat::Bits& a, const cppsat::Bits& b
+                                                    , const cppsat::Bit& carryIn, bool subtract )
+  {
+    const size_t              n = std::max (a.size (), b.size ());
+    std::vector <cppsat::Bit> sum;
+    std::vector <cppsat::Bit> carries;
+
+    sum    .reserve (n);
+    carries.reserve (n + 1);
+    carries.push_back (carryIn);
+
+    for (size_t i = 0; i < n; i++) {
+      const cppsat::Bit  ai    = bitAt (a, i);
+      const cppsat::Bit  bi    = subtract ? bitAt (b, i).negate () : bitAt (b, i);
+      const cppsat::Bit& carry = carries.back ();
+
+      if (ai.isConstant () || bi.isConstant ()) {
+        // adding a constant bit c to x and the carry is a half adder:
+        // x + carry + 0 = (x != carry, x && carry),
+        // x + carry + 1 = (x == carry, x || carry)
+        const cppsat::Bit& x = ai.isConstant () ? bi : ai;
+        const bool         c = ai.isConstant () ? ai.value () : bi.value ();
+
+        sum    .push_back (c ? x == carry : x != carry);
+        carries.push_back (c ? x || carry : x && carry);
+      }
+      else {
+        const BitPair r = fullAdder (ai, bi, carry);
+
+        sum    .push_back (r.first);
+        carries.push_back (r.second);
+      }
     }
+    return std::make_pair (cppsat::Bits (sum), carries.back ());
   }
 
-  typedef std::pair <cppsat::Bit, cppsat::Bit> BitPair;
+  // `bits` extended to `n` bits by copies of its most significant bit
+  cppsat::Bits signExtend (const cppsat::Bits& bits, size_t n) {
+    assert (bits.size () > 0);
+    cppsat::Bits result (bits.vector ());
 
-  BitPair compare (const cppsat::Bits& x, const cppsat::Bits& y) {
-    cppsat::Bits a (x);
-    cppsat::Bits b (y);
+    while (result.size () < n) {
+      result.add (bits[bits.size () - 1]);
+    }
+    return result;
+  }
 
-    equalizeLength (a, b);
+  // Maps two's complement numbers of `n` bits onto unsigned ones of the same
+  // order, by flipping their sign bit
+  cppsat::Bits flipSign (const cppsat::Bits& bits, size_t n) {
+    std::vector <cppsat::Bit> result = signExtend (bits, n).vector ();
 
-    std::function <BitPair (size_t)> go = [&go,&a,&b] (size_t i) {
-      if (i < a.size ()) {
-        auto         rest   = go (i+1);
-        cppsat::Bit& leRest = rest.first;
-        cppsat::Bit& eqRest = rest.second;
+    result.back () = result.back ().negate ();
+    return cppsat::Bits (result);
+  }
 
-        return BitPair ( leRest || (eqRest && !a[i] && b[i])
-                       , eqRest && (a[i] == b[i]) );
+  // `bits` shifted by `k` places towards the most significant bit, or
+  // towards the least significant one if `right` is set.  Vacated places
+  // are filled with `fill`.
+  cppsat::Bits shift (const cppsat::Bits& bits, size_t k, bool right, const cppsat::Bit& fill) {
+    const size_t              n = bits.size ();
+    std::vector <cppsat::Bit> result;
+    result.reserve (n);
+
+    for (size_t i = 0; i < n; i++) {
+      if (right) {
+        result.push_back (k < n - i ? bits[i + k] : fill);
       }
       else {
-        return BitPair (cppsat::Bit (false), cppsat::Bit (true));
+        result.push_back (i >= k ? bits[i - k] : cppsat::Bit (false));
       }
-    };
-    return go (0);
+    }
+    return cppsat::Bits (result);
   }
-}
-
-namespace cppsat {
 
-  Bit :: Bit ()
-    : _isConstant (false)
-    , _value      (Minisat::toInt (Minisat::mkLit (solver.newVar ())))
-  {}
+  // Barrel shifter: stage k shifts by 2^k places if bit k of `amount` is
+  // set.  If `overflow` is given, it receives a bit for every one that is
+  // shifted out.
+  cppsat::Bits barrelShift ( const cppsat::Bits& bits, const cppsat::Bits& amount, bool right
+                           , const cppsat::Bit& fill, BitVector* overflow )
+  {
+    const size_t n      = bits.size ();
+    cppsat::Bits result = bits;
+
+    for (size_t k = 0; k < amount.size (); k++) {
+      const size_t       distance = k < 8 * sizeof (size_t) - 1 ? std::min (size_t (1) << k, n) : n;
+      const cppsat::Bits shifted  = shift (result, distance, right, fill);
+      std::vector <cppsat::Bit> next;
+      next.reserve (n);
+
+      if (overflow) {
+        for (size_t i = n - distance; i < n; i++) {
+          overflow->push_back (amount[k] && result[i]);
+        }
+      }
+      for (size_t i = 0; i < n; i++) {
+        next.push_back (amount[k].ifThenElse (shifted[i], result[i]));
+      }
+      result = cppsat::Bits (next);
+    }
+    return result;
+  }
 
-  Bit :: Bit (bool b)
-    : _isConstant (true)
-    , _value      (b)
-  {}
+  // Restoring divider over the width of the wider operand.  The partial
+  // remainder has one more bit, so that doubling it cannot overflow.
+  std::pair <cppsat::Bits, cppsat::Bits> divide (const cppsat::Bits& a, const cppsat::Bits& b) {
+    const size_t              n = std::max (a.size (), b.size ());
+    std::vector <cppsat::Bit> quotient  (n, cppsat::Bit (false));
+    std::vector <cppsat::Bit> remainder (n + 1, cppsat::Bit (false));
 
-  Bit :: Bit (int i)
-    : _isConstant (false)
-    , _value      (i)
-  {}
+    for (size_t i = n; i > 0; i--) {
+      remainder.pop_back ();
+      remainder.insert (remainder.begin (), bitAt (a, i - 1));
 
-  Bit Bit :: operator!  ()             const { return this->negate (); }
-  Bit Bit :: operator&& (const Bit& o) const { return cppsat::all ({ *this, o }); }
-  Bit Bit :: operator|| (const Bit& o) const { return cppsat::any ({ *this, o }); }
-  Bit Bit :: operator== (const Bit& o) const { return this->equals    (o); }
-  Bit Bit :: operator!= (const Bit& o) const { return this->equalsNot (o); }
+      // the carry of the subtraction is set if the divisor fits
+      const auto difference = rippleCarry (cppsat::Bits (remainder), b, cppsat::Bit (true), true);
+      const cppsat::Bit fits = difference.second;
 
-  bool Bit :: isConstant () const {
-    return this->_isConstant;
+      quotient[i - 1] = fits;
+      for (size_t j = 0; j <= n; j++) {
+        remainder[j] = fits.ifThenElse (difference.first[j], remainder[j]);
+      }
+    }
+    remainder.pop_back ();
+    return std::make_pair (cppsat::Bits (quotient), cppsat::Bits (remainder));
   }
 
-  int Bit :: literal () const {
-    assert (this->isConstant () == false);
-    return this->_value;
+  // a < b, or a <= b if `orEqual` is set.  Scans from the least significant
+  // bit: the result is decided by the most significant differing bit.
+  cppsat::Bit lessThan (const cppsat::Bits& a, const cppsat::Bits& b, bool orEqual) {
+    const size_t n = std::max (a.size (), b.size ());
+
+    if (isConstant (a) || isConstant (b)) {
+      // Against a constant c, bit i turns the result so far into
+      //   x < c:  !x[i] || less  if c[i],  !x[i] && less  otherwise
+      //   c < x:   x[i] && less  if c[i],   x[i] || less  otherwise
+      // so every run of equal constant bits is a single conjunction or
+      // disjunction.
+      const bool right    = isConstant (b);
+      bool       runIsAny = false;
+      BitVector  run (1, cppsat::Bit (orEqual));
+
+      for (size_t i = 0; i < n; i++) {
+        const bool        c     = right ? bitAt (b, i).value () : bitAt (a, i).value ();
+        const cppsat::Bit x     = right ? bitAt (a, i).negate () : bitAt (b, i);
+        const bool        isAny = c == right;
+
+        if (i > 0 && isAny != runIsAny) {
+          const cppsat::Bit less = runIsAny ? cppsat::any (run) : cppsat::all (run);
+          run.clear ();
+          run.push_back (less);
+        }
+        run.push_back (x);
+        runIsAny = isAny;
+      }
+      return runIsAny ? cppsat::any (run) : cppsat::all (run);
+    }
+
+    std::vector <cppsat::Bit> less;
+
+    less.reserve (n + 1);
+    less.push_back (cppsat::Bit (orEqual));
+
+    for (size_t i = 0; i < n; i++) {
+      const cppsat::Bit bi = bitAt (b, i);
+
+      less.push_back ((bitAt (a, i) != bi).ifThenElse (bi, less.back ()));
+    }
+    return less.back ();
   }
 
-  bool Bit :: hasValue () const {
-    if (this->isConstant ()) {
-      return true;
+  // Multipliers sum up bits by weight: column i holds bits of weight 2^i.
+  // Bits that fall beyond the product's width are dropped.
+  typedef std::vector <BitVector> Columns;
+
+  // Replaces the last two (half adder) or three (full adder) bits of column
+  // i by their sum in column i and their carry in column i+1 of the next
+  // stage
+  void compress (Columns& columns, Columns& next, size_t i, size_t count) {
+    BitVector&    pool = columns[i];
+    const BitPair r    = count == 2
+      ? halfAdder (pool[pool.size () - 1], pool[pool.size () - 2])
+      : fullAdder (pool[pool.size () - 1], pool[pool.size () - 2], pool[pool.size () - 3]);
+
+    for (size_t j = 0; j < count; j++) {
+      pool.pop_back ();
     }
-    else {
-      return solver.model.size () > toMinisatVar (*this);
+    next[i].push_back (r.first);
+    if (i + 1 < next.size ()) {
+      next[i+1].push_back (r.second);
     }
   }
 
-  bool Bit :: hasValue (bool b) const {
-    return this->hasValue () && this->value () == b;
+  size_t maxHeight (const Columns& columns) {
+    size_t height = 0;
+    for (const BitVector& column : columns) {
+      height = std::max (height, column.size ());
+    }
+    return height;
   }
 
-  bool Bit :: value () const {
-    if (this->isConstant ()) {
-      return bool (this->_value);
+  // Dadda's schedule: the stage heights are 2, 3, 4, 6, 9, 13, ..., i.e.
+  // d_{j+1} = floor (1.5 d_j), and each stage compresses every column just
+  // enough to reach the next smaller height, counting the carries that it
+  // receives from the previous column
+  void daddaReduce (Columns& columns) {
+    std::vector <size_t> heights;
+    for (size_t d = 2; d < maxHeight (columns); d = (d * 3) / 2) {
+      heights.push_back (d);
     }
-    else {
-      assert (this->hasValue ());
+    for (auto d = heights.rbegin (); d != heights.rend (); ++d) {
+      Columns next (columns.size ());
 
-      Minisat::lbool v = solver.modelValue (toMinisatLit (*this));
-      if (v == Minisat::l_True) {
-        return true;
-      }
-      else if (v == Minisat::l_False) {
-        return false;
-      }
-      else {
-        std::abort ();
+      for (size_t i = 0; i < columns.size (); i++) {
+        BitVector& pool = columns[i];
+
+        while (pool.size () + next[i].size () > *d && pool.size () >= 2) {
+          const bool half = pool.size () + next[i].size () == *d + 1 || pool.size () == 2;
+          compress (columns, next, i, half ? 2 : 3);
+        }
+        for (const cppsat::Bit& bit : pool) {
+          next[i].push_back (bit);
+        }
       }
+      columns.swap (next);
+    }
+  }
+
+  // Wallace's schedule: each stage compresses every group of three bits of
+  // every column, and a remaining pair with a half adder
+  void wallaceReduce (Columns& columns) {
+    while (maxHeight (columns) > 2) {
+      Columns next (columns.size ());
+
+      for (size_t i = 0; i < columns.size (); i++) {
+        BitVector& pool = columns[i];
+
+        while (pool.size () >= 3) {
+          compress (columns, next, i, 3);
+        }
+        if (pool.size () == 2) {
+          compress (columns, next, i, 2);
+        }
+        for (const cppsat::Bit& bit : pool) {
+          next[i].push_back (bit);
+        }
+      }
+      columns.swap (next);
+    }
+  }
+
+  // Final carry-propagate addition of the (at most) two remaining rows
+  cppsat::Bits addColumns (const Columns& columns) {
+    BitVector first, second;
+    for (const BitVector& column : columns) {
+      assert (column.size () <= 2);
+
+      first .push_back (column.size () > 0 ? column[0] : cppsat::Bit (false));
+      second.push_back (column.size () > 1 ? column[1] : cppsat::Bit (false));
+    }
+    return rippleCarry (first, second, cppsat::Bit (false), false).first;
+  }
+
+  // Radix-4 Booth recoding of the unsigned multiplier `b`: each group
+  // b[2j+1], b[2j], b[2j-1] selects a partial product of 0, +-a or +-2a.
+  // A negative partial product is the complement of its magnitude plus one,
+  // and its sign extension is replaced by a single inverted sign bit and a
+  // constant that is accumulated over all partial products.
+  void boothPartialProducts (const cppsat::Bits& a, const cppsat::Bits& b, Columns& columns) {
+    const size_t       width = columns.size ();
+    std::vector <bool> constant (width, false);
+
+    for (size_t j = 0; 2 * j < b.size () + 1; j++) {
+      const cppsat::Bit high = bitAt (b, 2 * j + 1);
+      const cppsat::Bit mid  = bitAt (b, 2 * j);
+      const cppsat::Bit low  = j == 0 ? cppsat::Bit (false) : bitAt (b, 2 * j - 1);
+      const cppsat::Bit one  = mid != low;
+      const cppsat::Bit two  = (high && !mid && !low) || (!high && mid && low);
+      const cppsat::Bit neg  = high;
+
+      auto place = [&columns, width] (size_t i, const cppsat::Bit& bit) {
+        if (i < width) {
+          columns[i].push_back (bit);
+        }
+      };
+
+      for (size_t i = 0; i <= a.size (); i++) {
+        const cppsat::Bit select = (one && bitAt (a, i))
+                                || (two && (i == 0 ? cppsat::Bit (false) : bitAt (a, i - 1)));
+        place (2 * j + i, select != neg);
+      }
+
+      if (neg.isConstant () == false || neg.value ()) {
+        const size_t signPosition = 2 * j + a.size () + 1;
+
+        place (2 * j, neg);
+        place (signPosition, !neg);
+
+        // constant -= 2^signPosition
+        for (size_t i = signPosition; i < width; i++) {
+          constant[i] = ! constant[i];
+          if (constant[i] == false) {
+            break;
+          }
+        }
+      }
+    }
+    for (size_t i = 0; i < width; i++) {
+      if (constant[i]) {
+        columns[i].push_back (cppsat::Bit (true));
+      }
+    }
+  }
+
+  // Product of `a` and `b` modulo 2^width
+  cppsat::Bits multiply ( const cppsat::Bits& a, const cppsat::Bits& b, size_t width
+                        , cppsat::MultiplierEncoding encoding )
+  {
+    Columns columns (width);
+
+    if (isConstant (a) || isConstant (b)) {
+      // shift-and-add over the set bits of the constant operand
+      const cppsat::Bits& c = isConstant (a) ? a : b;
+      const cppsat::Bits& x = isConstant (a) ? b : a;
+
+      for (size_t i = 0; i < c.size (); i++) {
+        if (c[i].value ()) {
+          for (size_t j = 0; j < x.size () && i + j < width; j++) {
+            columns[i+j].push_back (x[j]);
+          }
+        }
+      }
+      daddaReduce (columns);
+    }
+    else if (encoding == cppsat::MultiplierEncoding::Booth) {
+      boothPartialProducts (a, b, columns);
+      daddaReduce (columns);
+    }
+    else {
+      for (size_t i = 0; i < a.size (); i++) {
+        for (size_t j = 0; j < b.size () && i + j < width; j++) {
+          columns[i+j].push_back (a[i] && b[j]);
+        }
+      }
+      if (encoding == cppsat::MultiplierEncoding::Wallace) {
+        wallaceReduce (columns);
+      }
+      else {
+        daddaReduce (columns);
+      }
+    }
+    return addColumns (columns);
+  }
+
+  // Arithmetic on constant, unsigned binary numbers, least significant bit
+  // first, as needed by the binary search of minimize
+
+  bool lessThan (const std::vector <bool>& a, const std::vector <bool>& b) {
+    assert (a.size () == b.size ());
+
+    for (size_t i = a.size (); i > 0; i--) {
+      if (a[i-1] != b[i-1]) {
+        return b[i-1];
+      }
+    }
+    return false;
+  }
+
+  std::vector <bool> increment (std::vector <bool> a) {
+    for (size_t i = 0; i < a.size (); i++) {
+      a[i] = ! a[i];
+      if (a[i]) {
+        break;
+      }
+    }
+    return a;
+  }
+
+  std::vector <bool> average (const std::vector <bool>& a, const std::vector <bool>& b) {
+    assert (a.size () == b.size ());
+
+    std::vector <bool> sum;
+    bool               carry = false;
+
+    for (size_t i = 0; i < a.size (); i++) {
+      sum.push_back ((a[i] != b[i]) != carry);
+      carry = (a[i] && b[i]) || (carry && (a[i] != b[i]));
+    }
+    sum.push_back (carry);
+    sum.erase (sum.begin ());
+    return sum;
+  }
+
+  // Cardinality constraints are built from unary counters: the i-th output
+  // of a counter over some bits is true iff at least i+1 of the bits are
+  // true.  Counters are truncated to `limit` outputs.
+
+  typedef cppsat::CardinalityEncoding CardinalityEncoding;
+
+  BitVector sequentialCounter (const BitVector& bits, size_t limit) {
+    BitVector count;
+
+    for (const cppsat::Bit& bit : bits) {
+      BitVector next;
+      for (size_t j = 0; j < std::min (count.size () + 1, limit); j++) {
+        const cppsat::Bit carry = j == 0 ? bit : bit && count[j-1];
+
+        next.push_back (j < count.size () ? count[j] || carry : carry);
+      }
+      count.swap (next);
+    }
+    return count;
+  }
+
+  BitVector totalizerMerge (const BitVector& a, const BitVector& b, size_t limit) {
+    BitVector count;
+
+    for (size_t j = 0; j < std::min (a.size () + b.size (), limit); j++) {
+      BitVector cases;
+      if (j < a.size ()) {
+        cases.push_back (a[j]);
+      }
+      if (j < b.size ()) {
+        cases.push_back (b[j]);
+      }
+      for (size_t i = 0; i < j; i++) {
+        if (i < a.size () && j - i - 1 < b.size ()) {
+          cases.push_back (a[i] && b[j - i - 1]);
+        }
+      }
+      count.push_back (cppsat::any (cases));
+    }
+    return count;
+  }
+
+  BitVector totalizer ( BitVector::const_iterator first, BitVector::const_iterator last
+                      , size_t limit )
+  {
+    const size_t n = last - first;
+
+    if (n == 1) {
+      return BitVector (1, *first);
+    }
+    else {
+      auto middle = first + n / 2;
+      return totalizerMerge ( totalizer (first, middle, limit)
+                            , totalizer (middle, last, limit), limit );
+    }
+  }
+
+  // Batcher's odd-even merge, sorting true bits to the front
+  BitVector oddEvenMerge (const BitVector& a, const BitVector& b) {
+    assert (a.size () == b.size ());
+
+    if (a.size () == 1) {
+      return { a[0] || b[0], a[0] && b[0] };
+    }
+    else {
+      BitVector aEven, aOdd, bEven, bOdd;
+      for (size_t i = 0; i < a.size (); i++) {
+        (i % 2 == 0 ? aEven : aOdd).push_back (a[i]);
+        (i % 2 == 0 ? bEven : bOdd).push_back (b[i]);
+      }
+      const BitVector even = oddEvenMerge (aEven, bEven);
+      const BitVector odd  = oddEvenMerge (aOdd , bOdd );
+
+      BitVector merged;
+      merged.push_back (even.front ());
+      for (size_t i = 0; i + 1 < even.size (); i++) {
+        merged.push_back (odd[i] || even[i+1]);
+        merged.push_back (odd[i] && even[i+1]);
+      }
+      merged.push_back (odd.back ());
+      return merged;
+    }
+  }
+
+  BitVector oddEvenMergeSort (BitVector::const_iterator first, BitVector::const_iterator last) {
+    const size_t n = last - first;
+
+    if (n == 1) {
+      return BitVector (1, *first);
+    }
+    else {
+      auto middle = first + n / 2;
+      return oddEvenMerge ( oddEvenMergeSort (first, middle)
+                          , oddEvenMergeSort (middle, last) );
+    }
+  }
+
+  BitVector sortingNetwork (const BitVector& bits, size_t limit) {
+    BitVector padded (bits);
+    size_t    n = 1;
+
+    while (n < bits.size ()) {
+      n *= 2;
+    }
+    while (padded.size () < n) {
+      padded.push_back (cppsat::Bit (false));
+    }
+
+    const BitVector sorted = oddEvenMergeSort (padded.begin (), padded.end ());
+    return BitVector (sorted.begin (), sorted.begin () + std::min (limit, bits.size ()));
+  }
+
+  BitVector unaryCount (const BitVector& bits, size_t limit, CardinalityEncoding encoding) {
+    assert (bits.empty () == false);
+
+    switch (encoding) {
+      case CardinalityEncoding::Totalizer:
+        return totalizer (bits.begin (), bits.end (), limit);
+      case CardinalityEncoding::SortingNetwork:
+        return sortingNetwork (bits, limit);
+      default:
+        return sequentialCounter (bits, limit);
+    }
+  }
+
+  cppsat::Bit atmostOnePairwise (const BitVector& bits) {
+    BitVector pairs;
+    for (size_t i = 0; i < bits.size (); i++) {
+      for (size_t j = i + 1; j < bits.size (); j++) {
+        pairs.push_back (bits[i] && bits[j]);
+      }
+    }
+    return cppsat::none (pairs);
+  }
+
+  // groups of three bits, each represented by a commander that is true iff
+  // one of the group's bits is true
+  cppsat::Bit atmostOneCommander (const BitVector& bits) {
+    const size_t groupSize = 3;
+
+    if (bits.size () <= groupSize + 1) {
+      return atmostOnePairwise (bits);
+    }
+    else {
+      BitVector groups, commanders;
+      for (size_t i = 0; i < bits.size (); i += groupSize) {
+        const BitVector group ( bits.begin () + i
+                              , bits.begin () + std::min (i + groupSize, bits.size ()) );
+
+        groups    .push_back (atmostOnePairwise (group));
+        commanders.push_back (cppsat::any (group));
+      }
+      groups.push_back (atmostOneCommander (commanders));
+      return cppsat::all (groups);
+    }
+  }
+
+  CardinalityEncoding chooseEncoding (unsigned int k, size_t n, CardinalityEncoding e) {
+    // Pairwise and Commander only encode at most one
+    const bool isAtmostOne = e == CardinalityEncoding::Pairwise
+                          || e == CardinalityEncoding::Commander;
+
+    if (e != CardinalityEncoding::Auto && (k == 1 || isAtmostOne == false)) {
+      return e;
+    }
+    else if (k == 1) {
+      return n <= 6 ? CardinalityEncoding::Pairwise
+                    : CardinalityEncoding::Commander;
+    }
+    else {
+      // estimated number of gates: 2nk for the sequential counter and
+      // n/2 log^2 n for the sorting network
+      size_t log = 0;
+      while ((size_t (1) << log) < n) {
+        log++;
+      }
+      return 2 * n * (k + 1) <= n * log * log / 2 ? CardinalityEncoding::SequentialCounter
+                                                  : CardinalityEncoding::SortingNetwork;
+    }
+  }
+
+  // A pseudo-Boolean constraint sum w_i x_i <= bound with positive weights
+  // over distinct variables, sorted by descending weight.  Weights larger
+  // than the bound are saturated to bound + 1 and the weights and the bound
+  // are divided by the weights' greatest common divisor.  Sums of longs
+  // and their negations are exact in 128 bits.
+  __extension__ typedef __int128 Weight;
+
+  struct PseudoBoolean {
+    std::vector <Weight> weights;
+    BitVector            bits;
+    Weight               bound;
+    Weight               total;
+  };
+
+  typedef cppsat::PseudoBooleanEncoding PseudoBooleanEncoding;
+
+  Weight greatestCommonDivisor (Weight a, Weight b) {
+    return b == 0 ? a : greatestCommonDivisor (b, a % b);
+  }
+
+  // Normalizes sum w_i x_i <= bound, or sum w_i x_i >= bound if `atleast`
+  // is set, which is sum -w_i x_i <= -bound
+  PseudoBoolean normalize ( const std::vector <long>& weights, const BitVector& bits
+                          , long limit, bool atleast )
+  {
+    assert (weights.size () == bits.size ());
+    const Weight sign  = atleast ? -1 : 1;
+    Weight       bound = sign * Weight (limit);
+
+    // w * !x = w - w * x, so that all terms are over positive literals
+    std::map <cppsat::Bit, Weight> terms;
+    for (size_t i = 0; i < bits.size (); i++) {
+      const Weight w = sign * Weight (weights[i]);
+
+      if (bits[i].isConstant ()) {
+        bound -= bits[i].isConstant (true) ? w : 0;
+      }
+      else if (bits[i].literal () % 2 == 1) {
+        bound -= w;
+        terms[bits[i].negate ()] -= w;
+      }
+      else {
+        terms[bits[i]] += w;
+      }
+    }
+
+    // w * x = w + (-w) * !x, so that all weights are positive
+    std::vector <std::pair <Weight, cppsat::Bit>> positive;
+    for (const auto& term : terms) {
+      if (term.second > 0) {
+        positive.emplace_back (term.second, term.first);
+      }
+      else if (term.second < 0) {
+        bound -= term.second;
+        positive.emplace_back (- term.second, term.first.negate ());
+      }
+    }
+    std::stable_sort ( positive.begin (), positive.end ()
+                     , [] (const std::pair <Weight, cppsat::Bit>& a
+                         , const std::pair <Weight, cppsat::Bit>& b)
+    {
+      return a.first > b.first;
+    });
+
+    PseudoBoolean pb;
+    pb.bound = bound;
+    pb.total = 0;
+    for (const auto& term : positive) {
+      pb.total += term.first;
+    }
+
+    // otherwise the constraint is constant
+    if (bound >= 0 && bound < pb.total) {
+      Weight divisor = 0;
+      for (const auto& term : positive) {
+        divisor = greatestCommonDivisor (std::min (term.first, bound + 1), divisor);
+      }
+      pb.bound = bound / divisor;
+      pb.total = 0;
+
+      for (const auto& term : positive) {
+        pb.weights.push_back (std::min (term.first, bound + 1) / divisor);
+        pb.bits   .push_back (term.second);
+        pb.total  += pb.weights.back ();
+      }
+    }
+    return pb;
+  }
+
+  // The BDD of Abío et al.: every node is annotated with the interval of
+  // bounds for which it is the BDD of its suffix of terms, so that nodes are
+  // shared between all bounds of that interval.  No bound that is asked for
+  // is below -total or above the total, which therefore stand in for the
+  // infinite ends of intervals.
+  class PseudoBooleanBdd {
+    public:
+      explicit PseudoBooleanBdd (const PseudoBoolean& pb)
+        : _pb (pb), _suffix (pb.bits.size () + 1, 0), _nodes (pb.bits.size ())
+      {
+        for (size_t i = pb.bits.size (); i > 0; i--) {
+          this->_suffix[i-1] = this->_suffix[i] + pb.weights[i-1];
+        }
+      }
+
+      cppsat::Bit build () {
+        return this->node (0, this->_pb.bound).bit;
+      }
+
+    private:
+      struct Node {
+        Weight      low;
+        Weight      high;
+        cppsat::Bit bit;
+      };
+
+      Node node (size_t i, Weight bound) {
+        if (bound < 0) {
+          return Node { - this->_pb.total - 1, -1, cppsat::Bit (false) };
+        }
+        else if (bound >= this->_suffix[i]) {
+          return Node { this->_suffix[i], this->_pb.total, cppsat::Bit (true) };
+        }
+        for (const Node& n : this->_nodes[i]) {
+          if (n.low <= bound && bound <= n.high) {
+            return n;
+          }
+        }
+        const Weight w    = this->_pb.weights[i];
+        const Node   then = this->node (i + 1, bound - w);
+        const Node   els  = this->node (i + 1, bound);
+        const Node   n    = { std::max (then.low + w, els.low)
+                            , std::min (then.high + w, els.high)
+                            , this->_pb.bits[i].ifThenElse (then.bit, els.bit) };
+
+        this->_nodes[i].push_back (n);
+        return n;
+      }
+
+      const PseudoBoolean&             _pb;
+      std::vector <Weight>             _suffix;
+      std::vector <std::vector <Node>> _nodes;
+  };
+
+  // Adder network of Eén and Sörensson: bits of equal significance are
+  // collected in buckets, which full adders reduce to a single bit each
+  cppsat::Bit pbAdder (const PseudoBoolean& pb) {
+    std::vector <BitVector> buckets;
+    for (size_t i = 0; i < pb.bits.size (); i++) {
+      for (size_t j = 0; (pb.weights[i] >> j) != 0; j++) {
+        if ((pb.weights[i] >> j) & 1) {
+          buckets.resize (std::max (buckets.size (), j + 1));
+          buckets[j].push_back (pb.bits[i]);
+        }
+      }
+    }
+
+    std::vector <cppsat::Bit> sum;
+    for (size_t j = 0; j < buckets.size (); j++) {
+      size_t next = 0;
+
+      while (buckets[j].size () - next >= 2) {
+        const cppsat::Bit a = buckets[j][next++];
+        const cppsat::Bit b = buckets[j][next++];
+        const cppsat::Bit c = next < buckets[j].size () ? buckets[j][next++] : cppsat::Bit (false);
+
+        if (j + 1 >= buckets.size ()) {
+          buckets.emplace_back ();
+        }
+        buckets[j]  .push_back ((a != b) != c);
+        buckets[j+1].push_back ((a && b) || (c && (a != b)));
+      }
+      sum.push_back (next < buckets[j].size () ? buckets[j][next] : cppsat::Bit (false));
+    }
+
+    std::vector <bool> bound;
+    for (size_t j = 0; j < sum.size (); j++) {
+      bound.push_back (j + 1 < 8 * sizeof (Weight) && ((pb.bound >> j) & 1));
+    }
+    return lessThan (cppsat::Bits (sum), cppsat::Bits (bound), true);
+  }
+
+  // Every bit is repeated as often as its weight and the repetitions are
+  // counted by a sorting network
+  cppsat::Bit pbSortingNetwork (const PseudoBoolean& pb) {
+    BitVector unary;
+    for (size_t i = 0; i < pb.bits.size (); i++) {
+      unary.insert (unary.end (), size_t (pb.weights[i]), pb.bits[i]);
+    }
+    return unaryCount (unary, size_t (pb.bound) + 1, CardinalityEncoding::SortingNetwork)
+             [size_t (pb.bound)].negate ();
+  }
+
+  PseudoBooleanEncoding chooseEncoding (const PseudoBoolean& pb, PseudoBooleanEncoding e) {
+    if (e != PseudoBooleanEncoding::Auto) {
+      return e;
+    }
+    else {
+      // estimated number of gates: n (k+1) nodes for the BDD, two per full
+      // adder for the adder network and S/2 log^2 S for the sorting network
+      // over the S repetitions
+      const double n     = double (pb.bits.size ());
+      const double total = double (pb.total);
+      double log = 0, digits = 0;
+      while (std::pow (2.0, log) < total) {
+        log++;
+      }
+      while ((pb.weights.front () >> int (digits)) != 0) {
+        digits++;
+      }
+
+      const double bdd     = n * (double (pb.bound) + 1);
+      const double adder   = 2.0 * n * digits + 4.0 * log;
+      const double sorting = total * log * log / 2;
+
+      if (bdd <= adder && bdd <= sorting) {
+        return PseudoBooleanEncoding::Bdd;
+      }
+      else {
+        return sorting <= adder ? PseudoBooleanEncoding::SortingNetwork
+                                : PseudoBooleanEncoding::Adder;
+      }
+    }
+  }
+
+  cppsat::Bit pseudoBoolean (const PseudoBoolean& pb, PseudoBooleanEncoding e) {
+    if (pb.bound < 0) {
+      return cppsat::Bit (false);
+    }
+    else if (pb.total <= pb.bound) {
+      return cppsat::Bit (true);
+    }
+    else if (e == PseudoBooleanEncoding::Auto && pb.weights.front () == pb.weights.back ()) {
+      return cppsat::atmost (unsigned (pb.bound / pb.weights.front ()), pb.bits);
+    }
+    else {
+      switch (chooseEncoding (pb, e)) {
+        case PseudoBooleanEncoding::Adder:          return pbAdder          (pb);
+        case PseudoBooleanEncoding::SortingNetwork: return pbSortingNetwork (pb);
+        default:
+          return PseudoBooleanBdd (pb).build ();
+      }
+    }
+  }
+
+  // Collects the solver assumptions for the open scopes and the given bits,
+  // or returns false if one of them is constantly false
+  bool assumptionLiterals ( const std::vector <cppsat::Bit>& assumptions
+                          , std::vector <int>& lits )
+  {
+    cppsat::Context::State& s = state ();
+    s.core.clear ();
+    s.model.clear ();
+    s.evaluated.clear ();
+
+    for (const cppsat::Bit& scope : s.scopes) {
+      lits.push_back (scope.literal ());
+    }
+    for (const cppsat::Bit& assumption : assumptions) {
+      if (assumption.isConstant () == false) {
+        const int literal = assumption.literal ();
+        require (&literal, 1);
+        lits.push_back (assumption.literal ());
+      }
+      else if (assumption.value () == false) {
+        s.core.push_back (assumption);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void computeCore (const Solver& solver, const std::vector <cppsat::Bit>& assumptions) {
+    cppsat::Context::State& s = state ();
+
+    for (const cppsat::Bit& assumption : assumptions) {
+      if (assumption.isConstant () == false && solver.failed (assumption.literal ())) {
+        s.core.push_back (assumption);
+      }
+    }
+  }
+
+  // Unit propagation over the clause log.  It ranks variables by the
+  // number of literals that their assignments imply, in order to pick the
+  // variables on which the search space is split into cubes.
+  class Lookahead {
+    public:
+      Lookahead (const std::vector <int>& clauses, int numVars)
+        : clauses     (clauses)
+        , occurrences (2 * numVars)
+        , values      (numVars, 0)
+        , head        (0)
+      {
+        for (size_t i = 0; i < clauses.size (); i += clauses[i] + 1) {
+          for (int j = 1; j <= clauses[i]; j++) {
+            this->occurrences[clauses[i + j]].push_back (i);
+          }
+        }
+      }
+
+      int value (int literal) const {
+        const int v = this->values[literal >> 1];
+        return (literal & 1) ? -v : v;
+      }
+
+      size_t size () const {
+        return this->trail.size ();
+      }
+
+      // Assigns the given literals and propagates them, or returns false
+      // on a conflict.  Assignments stay until `undo` is called.
+      bool propagate (const std::vector <int>& literals) {
+        for (int literal : literals) {
+          if (this->assign (literal) == false) {
+            return false;
+          }
+        }
+        while (this->head < this->trail.size ()) {
+          const int falsified = this->trail[this->head++] ^ 1;
+
+          for (size_t c : this->occurrences[falsified]) {
+            int  unassigned = -1;
+            bool satisfied  = false;
+            bool unit       = true;
+
+            for (int j = 1; j <= this->clauses[c] && satisfied == false; j++) {
+              const int literal = this->clauses[c + j];
+              const int v       = this->value (literal);
+
+              if (v > 0) {
+                satisfied = true;
+              }
+              else if (v == 0) {
+                unit       = unassigned == -1;
+                unassigned = literal;
+              }
+            }
+            if (satisfied || unit == false) {
+              continue;
+            }
+            else if (unassigned == -1 || this->assign (unassigned) == false) {
+              return false;
+            }
+          }
+        }
+        return true;
+      }
+
+      void undo (size_t size) {
+        while (this->trail.size () > size) {
+          this->values[this->trail.back () >> 1] = 0;
+          this->trail.pop_back ();
+        }
+        this->head = size;
+      }
+
+    private:
+      bool assign (int literal) {
+        const int v = this->value (literal);
+        if (v == 0) {
+          this->values[literal >> 1] = (literal & 1) ? -1 : 1;
+          this->trail.push_back (literal);
+        }
+        return v >= 0;
+      }
+
+      const std::vector <int>&            clauses;
+      std::vector <std::vector <size_t>>  occurrences;
+      std::vector <int>                   values;
+      std::vector <int>                   trail;
+      size_t                              head;
+  };
+
+  // Picks `depth` variables to split on, preferring the ones whose both
+  // assignments imply many literals
+  std::vector <int> lookahead (unsigned int depth, const std::vector <int>& assumptions) {
+    cppsat::Context::State& s = state ();
+    const int               numVars = s.solver->numVars ();
+    Lookahead               look (s.clauses, numVars);
+    std::vector <int>       root;
+
+    for (size_t i = 0; i < s.clauses.size (); i += s.clauses[i] + 1) {
+      if (s.clauses[i] == 1) {
+        root.push_back (s.clauses[i + 1]);
+      }
+    }
+    root.insert (root.end (), assumptions.begin (), assumptions.end ());
+    if (look.propagate (root) == false) {
+      return {};
+    }
+
+    // Only the most frequent variables are looked at
+    std::vector <size_t> frequency (numVars, 0);
+    for (size_t i = 0; i < s.clauses.size (); i += s.clauses[i] + 1) {
+      for (int j = 1; j <= s.clauses[i]; j++) {
+        frequency[s.clauses[i + j] >> 1]++;
+      }
+    }
+    std::vector <int> candidates;
+    for (int v = 0; v < numVars; v++) {
+      if (look.value (2 * v) == 0 && frequency[v] > 0) {
+        candidates.push_back (v);
+      }
+    }
+    const size_t limit = std::min (candidates.size (), size_t (32 + 8 * depth));
+    std::partial_sort ( candidates.begin (), candidates.begin () + limit, candidates.end ()
+                      , [&frequency] (int a, int b) { return frequency[a] > frequency[b]; } );
+    candidates.resize (limit);
+
+    std::vector <std::pair <size_t, int>> scores;
+    for (int v : candidates) {
+      const size_t mark = look.size ();
+
+      if (look.value (2 * v) != 0) {
+        continue;
+      }
+      const bool   positive = look.propagate ({ 2 * v });
+      const size_t p        = look.size () - mark;
+      look.undo (mark);
+      const bool   negative = look.propagate ({ 2 * v + 1 });
+      const size_t n        = look.size () - mark;
+      look.undo (mark);
+
+      // A failed literal fixes the variable, which is then no use for splitting
+      if (positive && negative) {
+        scores.push_back ({ (p + 1) * (n + 1), v });
+      }
+      else if (positive == false && negative == false) {
+        return {};
+      }
+      else if (look.propagate ({ positive ? 2 * v : 2 * v + 1 }) == false) {
+        return {};
+      }
+    }
+    std::sort (scores.rbegin (), scores.rend ());
+
+    std::vector <int> split;
+    for (size_t i = 0; i < scores.size () && split.size () < depth; i++) {
+      split.push_back (2 * scores[i].second);
+    }
+    return split;
+  }
+
+  // Splits are limited to 2^maxSplit cubes.  Any prefix of a split still
+  // covers all assignments, so longer splits are truncated.
+  const size_t maxSplit = 20;
+
+  // Solves all combinations of the literals in `split` on a pool of
+  // solvers.  Idle workers take the next unsolved cube.
+  bool conquer ( const std::vector <int>& split, unsigned int threads
+               , const std::vector <int>& assumptions )
+  {
+    cppsat::Context::State& s = state ();
+    Stopwatch               stopwatch (s.statistics.solvingSeconds);
+    if (threads == 0) {
+      threads = std::max (1u, std::thread::hardware_concurrency ());
+    }
+    assert (split.size () <= maxSplit);
+    const size_t numCubes = size_t (1) << split.size ();
+    threads = unsigned (std::min (size_t (threads), numCubes));
+
+    std::vector <std::unique_ptr <Solver>> copies;
+    std::vector <Solver*> solvers { s.solver.get () };
+    for (unsigned int i = 1; i < threads; i++) {
+      copies.push_back (newSolver (s.backend));
+      solvers.push_back (copies.back ().get ());
+    }
+
+    std::atomic <size_t> next    (0);
+    std::atomic <int>    winner  (-1);
+    std::atomic <bool>   done    (false);
+    std::mutex           mutex;
+    std::vector <std::thread> workers;
+    Running              running (s, solvers);
+
+    auto stop = [&] () {
+      std::lock_guard <std::mutex> lock (mutex);
+      done = true;
+      for (Solver* solver : solvers) {
+        solver->interrupt ();
+      }
+    };
+
+    for (unsigned int i = 0; i < threads; i++) {
+      workers.emplace_back ([&, i] () {
+        Solver& solver = *solvers[i];
+        if (i > 0) {
+          loadClauses (solver, s.clauses, s.solver->numVars ());
+        }
+        std::vector <int> lits;
+
+        for (size_t cube = next++; cube < numCubes && done == false; cube = next++) {
+          lits = assumptions;
+          for (size_t j = 0; j < split.size (); j++) {
+            lits.push_back (split[j] ^ int ((cube >> j) & 1));
+          }
+
+          const Result r = solver.solve (lits, cppsat::Budget ());
+          if (r == Result::Sat) {
+            int none = -1;
+            if (winner.compare_exchange_strong (none, int (i))) {
+              stop ();
+            }
+            return;
+          }
+          else if (r == Result::Unsat) {
+            // A conflict without cube literals refutes all cubes
+            const bool refutesCube = std::any_of ( lits.begin () + assumptions.size (), lits.end ()
+                                                 , [&solver] (int literal) {
+                                                     return solver.failed (literal);
+                                                   } );
+            if (refutesCube == false) {
+              stop ();
+              return;
+            }
+          }
+          else {
+            return;
+          }
+        }
+      });
+    }
+    for (std::thread& worker : workers) {
+      worker.join ();
+    }
+
+    if (winner >= 0) {
+      storeModel (*solvers[winner]);
+    }
+    return winner >= 0;
+  }
+}
+
+namespace cppsat {
+
+  Context :: Context (Backend backend)
+    : _state (new State)
+  {
+    this->_state->backend = backend;
+    this->_state->solver  = newSolver (backend);
+  }
+
+  Context :: ~Context () {}
+
+  Context::State& Context :: state () {
+    return *this->_state;
+  }
+
+  Context& Context :: current () {
+    static Context defaultContext;
+
+    return currentContext == nullptr ? defaultContext : *currentContext;
+  }
+
+  void Context :: interrupt () {
+    std::lock_guard <std::mutex> lock (this->_state->runningMutex);
+    this->_state->interrupted = true;
+    for (Solver* solver : this->_state->running) {
+      solver->interrupt ();
+    }
+  }
+
+  ContextScope :: ContextScope (Context& context)
+    : _previous (currentContext)
+  {
+    currentContext = &context;
+  }
+
+  ContextScope :: ~ContextScope () {
+    currentContext = this->_previous;
+  }
+
+  static_assert ( std::is_trivially_copyable <Bit>::value && sizeof (Bit) == sizeof (int)
+                , "Bit is a plain literal" );
+
+  Bit :: Bit ()
+    : _literal (2 * state ().solver->newVar ())
+  {}
+
+  Bit :: Bit (bool b)
+    : _literal (b ? -1 : -2)
+  {}
+
+  Bit :: Bit (int i)
+    : _literal (i)
+  {}
+
+  Bit Bit :: operator!  ()             const { return this->negate (); }
+  Bit Bit :: operator&& (const Bit& o) const { return cppsat::all ({ *this, o }); }
+  Bit Bit :: operator|| (const Bit& o) const { return cppsat::any ({ *this, o }); }
+  Bit Bit :: operator== (const Bit& o) const { return this->equals    (o); }
+  Bit Bit :: operator!= (const Bit& o) const { return this->equalsNot (o); }
+
+  bool Bit :: isConstant () const {
+    return this->_literal < 0;
+  }
+
+  bool Bit :: isConstant (bool b) const {
+    return this->_literal == (b ? -1 : -2);
+  }
+
+  int Bit :: literal () const {
+    assert (this->isConstant () == false);
+    return this->_literal;
+  }
+
+  bool Bit :: hasValue () const {
+    if (this->isConstant ()) {
+      return true;
+    }
+    else {
+      return state ().model.size () > size_t (this->literal () >> 1);
+    }
+  }
+
+  bool Bit :: hasValue (bool b) const {
+    return this->hasValue () && this->value () == b;
+  }
+
+  bool Bit :: value () const {
+    if (this->isConstant ()) {
+      return this->_literal == -1;
+    }
+    else {
+      assert (this->hasValue ());
+      return evaluate (this->literal ());
     }
   }
 
   Bit Bit :: negate () const {
-    return this->isConstant () ? Bit (! this->value ())
-                               : Bit (Minisat::toInt (~toMinisatLit (*this)));
+    return Bit (this->_literal ^ 1);
+  }
+
+  Bit Bit :: implies (const Bit& other) const {
+    return this->negate () || other;
+  }
+
+  Bit Bit :: equals (const Bit& other) const {
+    return this->equalsNot (other).negate ();
+  }
+
+  Bit Bit :: equalsNot (const Bit& other) const {
+    OperationScope scope (Operation::EqualsNot);
+
+    if (this->isConstant ()) {
+      return this->value () ? other.negate ()
+                            : other;
+    }
+    else if (other.isConstant ()) {
+      return other.value () ? this->negate ()
+                            : *this;
+    }
+    else if (this->literal () == other.literal ()) {
+      return Bit (false);
+    }
+    else if (this->literal () == (other.literal () ^ 1)) {
+      return Bit (true);
+    }
+    else {
+      // a != b == !a != !b, so the cache only holds gates over positive inputs
+      const bool    flip = (this->literal () & 1) != (other.literal () & 1);
+      const Bit     a    = (this->literal () & 1) ? this->negate () : *this;
+      const Bit     b    = (other.literal () & 1) ? other.negate () : other;
+      const GateKey key  = { GateType::Xor, { std::min (a.literal (), b.literal ())
+                                            , std::max (a.literal (), b.literal ()) } };
+
+      Context::State& s     = state ();
+      GateCache&      gates = s.gates;
+
+      auto it = gates.find (key);
+      s.statistics.gateLookups++;
+      if (it != gates.end ()) {
+        s.statistics.gateHits++;
+        return flip ? it->second.negate () : it->second;
+      }
+
+      Bit result;
+      defineGate (GateType::Xor, key.inputs, result);
+
+      gates.emplace (key, result);
+      return flip ? result.negate () : result;
+    }
+  }
+
+  Bit Bit :: ifThenElse  (const Bit& t, const Bit& f) const {
+    OperationScope scope (Operation::IfThenElse);
+
+    if (this->isConstant ()) {
+      return this->value () ? t : f;
+    }
+    else if (this->literal () & 1) {
+      return this->negate ().ifThenElse (f, t);
+    }
+    else if (t.isConstant () && f.isConstant ()) {
+      return t.value () == f.value () ? t
+                                      : t.value () ? *this : this->negate ();
+    }
+    else if (t.isConstant ()) {
+      return t.value () ? *this || f : this->negate () && f;
+    }
+    else if (f.isConstant ()) {
+      return f.value () ? this->negate () || t : *this && t;
+    }
+    else if (t.literal () == f.literal ()) {
+      return t;
+    }
+    else if (t.literal () == (f.literal () ^ 1)) {
+      return this->equals (t);
+    }
+    else if (t.literal () == this->literal ()) {
+      return *this || f;
+    }
+    else if (t.literal () == (this->literal () ^ 1)) {
+      return this->negate () && f;
+    }
+    else if (f.literal () == this->literal ()) {
+      return *this && t;
+    }
+    else if (f.literal () == (this->literal () ^ 1)) {
+      return this->negate () || t;
+    }
+    else if (t.literal () & 1) {
+      // c ? t : f == !(c ? !t : !f), so the cache only holds positive then-inputs
+      return this->ifThenElse (t.negate (), f.negate ()).negate ();
+    }
+    else {
+      const GateKey key = { GateType::Ite, { this->literal (), t.literal (), f.literal () } };
+
+      Context::State& s     = state ();
+      GateCache&      gates = s.gates;
+
+      auto it = gates.find (key);
+      s.statistics.gateLookups++;
+      if (it != gates.end ()) {
+        s.statistics.gateHits++;
+        return it->second;
+      }
+
+      Bit result;
+      defineGate (GateType::Ite, key.inputs, result);
+
+      gates.emplace (key, result);
+      return result;
+    }
+  }
+
+  Bits :: Bits () {}
+
+  Bits :: Bits (size_t s) 
+    : _bits (s) 
+  {}
+
+  Bits :: Bits (size_t s, unsigned int i) 
+    : Bits (toBinary (s, i))
+  {}
+
+  Bits :: Bits (const std::vector <Bit>& bits) 
+    : _bits (bits) 
+  {}
+
+  Bits :: Bits (const std::vector <bool>& bits) {
+    for (bool b : bits) {
+      this->add (Bit (b));
+    }
+  }
+
+  Bits Bits :: operator! () const { return this->negate (); }
+
+  Bits Bits :: operator+ (const Bits& other) const {
+    OperationScope scope (Operation::Add);
+
+    const std::pair <Bits, Bit> r = rippleCarry (*this, other, Bit (false), false);
+
+    cppsat::assertAny ({ ! r.second });
+    return r.first;
+  }
+
+  Bits Bits :: operator- (const Bits& other) const {
+    OperationScope scope (Operation::Add);
+
+    const std::pair <Bits, Bit> r = rippleCarry (*this, other, Bit (true), true);
+
+    cppsat::assertAny ({ r.second });
+    return r.first;
+  }
+
+  Bits Bits :: operator* (const Bits& other) const {
+    OperationScope scope (Operation::Multiply);
+
+    const size_t width   = std::max (this->size (), other.size ());
+    const Bits   product = this->multiplyFull (other);
+    Bits         result;
+
+    for (size_t i = 0; i < product.size (); i++) {
+      if (i < width) {
+        result.add (product[i]);
+      }
+      else {
+        cppsat::assertAny ({ ! product[i] });
+      }
+    }
+    return result;
+  }
+
+  Bits Bits :: multiplyFull (const Bits& other, MultiplierEncoding encoding) const {
+    OperationScope scope (Operation::Multiply);
+
+    return multiply (*this, other, this->size () + other.size (), encoding);
+  }
+
+  std::pair <Bits, Bit> Bits :: addWithCarry (const Bits& other, const Bit& carry) const {
+    OperationScope scope (Operation::Add);
+
+    return rippleCarry (*this, other, carry, false);
+  }
+
+  std::pair <Bits, Bit> Bits :: subtractWithBorrow (const Bits& other, const Bit& borrow) const {
+    OperationScope scope (Operation::Add);
+
+    const std::pair <Bits, Bit> r = rippleCarry (*this, other, borrow.negate (), true);
+
+    return std::make_pair (r.first, r.second.negate ());
+  }
+
+  Bits Bits :: operator/ (const Bits& other) const {
+    OperationScope scope (Operation::Divide);
+
+    cppsat::assertAny (other.vector ());
+    return divide (*this, other).first;
+  }
+
+  Bits Bits :: operator% (const Bits& other) const {
+    OperationScope scope (Operation::Divide);
+
+    cppsat::assertAny (other.vector ());
+    return divide (*this, other).second;
+  }
+
+  Bits Bits :: operator- () const {
+    OperationScope scope (Operation::Add);
+
+    // only the most negative number is its own negation besides zero
+    const Bits r = this->twosComplement ();
+    cppsat::assertAny ({ ! (*this)[this->size () - 1], ! r[r.size () - 1] });
+    return r;
+  }
+
+  Bits Bits :: operator<< (size_t k) const {
+    OperationScope scope (Operation::Shift);
+
+    for (size_t i = k < this->size () ? this->size () - k : 0; i < this->size (); i++) {
+      cppsat::assertAny ({ ! (*this)[i] });
+    }
+    return shift (*this, k, false, Bit (false));
+  }
+
+  Bits Bits :: operator<< (const Bits& amount) const {
+    OperationScope scope (Operation::Shift);
+
+    BitVector  overflow;
+    const Bits r = barrelShift (*this, amount, false, Bit (false), &overflow);
+    for (const Bit& o : overflow) {
+      cppsat::assertAny ({ ! o });
+    }
+    return r;
+  }
+
+  Bits Bits :: operator>> (size_t k) const {
+    OperationScope scope (Operation::Shift);
+
+    return shift (*this, k, true, Bit (false));
+  }
+
+  Bits Bits :: operator>> (const Bits& amount) const {
+    OperationScope scope (Operation::Shift);
+
+    return barrelShift (*this, amount, true, Bit (false), nullptr);
+  }
+
+  Bits Bits :: addWrap (const Bits& other) const {
+    OperationScope scope (Operation::Add);
+
+    return rippleCarry (*this, other, Bit (false), false).first;
+  }
+
+  Bits Bits :: subtractWrap (const Bits& other) const {
+    OperationScope scope (Operation::Add);
+
+    return rippleCarry (*this, other, Bit (true), true).first;
+  }
+
+  Bits Bits :: multiplyWrap (const Bits& other) const {
+    OperationScope scope (Operation::Multiply);
+
+    return multiply ( *this, other, std::max (this->size (), other.size ())
+                    , MultiplierEncoding::Dadda );
+  }
+
+  Bits Bits :: twosComplement () const {
+    OperationScope scope (Operation::Add);
+
+    const Bits zero (std::vector <bool> (this->size (), false));
+    return rippleCarry (zero, *this, Bit (true), true).first;
+  }
+
+  Bits Bits :: shiftLeftWrap (size_t k) const {
+    OperationScope scope (Operation::Shift);
+
+    return shift (*this, k, false, Bit (false));
+  }
+
+  Bits Bits :: shiftLeftWrap (const Bits& amount) const {
+    OperationScope scope (Operation::Shift);
+
+    return barrelShift (*this, amount, false, Bit (false), nullptr);
+  }
+
+  std::pair <Bits, Bits> Bits :: divMod (const Bits& other) const {
+    OperationScope scope (Operation::Divide);
+
+    return divide (*this, other);
+  }
+
+  Bits Bits :: addSigned (const Bits& other) const {
+    OperationScope scope (Operation::Add);
+
+    const size_t n = std::max (this->size (), other.size ());
+    const Bits   a = signExtend (*this, n);
+    const Bits   b = signExtend (other, n);
+    const Bits   r = rippleCarry (a, b, Bit (false), false).first;
+
+    // overflows if both operands have the same sign and the result not
+    cppsat::assertAny ({ a[n-1] != b[n-1], a[n-1] == r[n-1] });
+    return r;
+  }
+
+  Bits Bits :: subtractSigned (const Bits& other) const {
+    OperationScope scope (Operation::Add);
+
+    const size_t n = std::max (this->size (), other.size ());
+    const Bits   a = signExtend (*this, n);
+    const Bits   b = signExtend (other, n);
+    const Bits   r = rippleCarry (a, b, Bit (true), true).first;
+
+    // overflows if the operands have different signs and the result has
+    // the sign of the subtrahend
+    cppsat::assertAny ({ a[n-1] == b[n-1], a[n-1] == r[n-1] });
+    return r;
+  }
+
+  Bits Bits :: shiftRightArithmetic (size_t k) const {
+    OperationScope scope (Operation::Shift);
+
+    return shift (*this, k, true, (*this)[this->size () - 1]);
+  }
+
+  Bits Bits :: shiftRightArithmetic (const Bits& amount) const {
+    OperationScope scope (Operation::Shift);
+
+    return barrelShift (*this, amount, true, (*this)[this->size () - 1], nullptr);
   }
 
-  Bit Bit :: implies (const Bit& other) const {
-    return this->negate () || other;
+  Bit Bits :: lessSigned (const Bits& other) const {
+    OperationScope scope (Operation::Compare);
+
+    const size_t n = std::max (this->size (), other.size ());
+    return lessThan (flipSign (*this, n), flipSign (other, n), false);
   }
 
-  Bit Bit :: equals (const Bit& other) const {
-    return this->equalsNot (other).negate ();
+  Bit Bits :: lessEqualSigned (const Bits& other) const {
+    OperationScope scope (Operation::Compare);
+
+    const size_t n = std::max (this->size (), other.size ());
+    return lessThan (flipSign (*this, n), flipSign (other, n), true);
   }
 
-  Bit Bit :: equalsNot (const Bit& other) const {
-    if (this->hasValue ()) {
-      return this->value () ? other.negate ()
-                            : other;
+  Bit Bits :: greaterSigned (const Bits& other) const {
+    return other.lessSigned (*this);
+  }
+
+  Bit Bits :: greaterEqualSigned (const Bits& other) const {
+    return other.lessEqualSigned (*this);
+  }
+
+  Bit Bits :: operator== (const Bits& other) const {
+    OperationScope scope (Operation::Compare);
+
+    const size_t n = std::max (this->size (), other.size ());
+
+    std::vector <Bit> equal;
+    equal.reserve (n);
+
+    for (size_t i = 0; i < n; i++) {
+      const Bit a = bitAt (*this, i);
+      const Bit b = bitAt (other, i);
+
+      if (a.isConstant ()) {
+        equal.push_back (a.value () ? b : b.negate ());
+      }
+      else if (b.isConstant ()) {
+        equal.push_back (b.value () ? a : a.negate ());
+      }
+      else {
+        equal.push_back (a == b);
+      }
     }
-    else if (other.hasValue ()) {
-      return other.value () ? this->negate ()
-                            : *this;
+    return cppsat::all (equal);
+  }
+
+  Bit Bits :: operator!= (const Bits& other) const {
+    return this->operator== (other).negate ();
+  }
+
+  Bit Bits :: operator< (const Bits& other) const {
+    OperationScope scope (Operation::Compare);
+
+    return lessThan (*this, other, false);
+  }
+
+  Bit Bits :: operator<= (const Bits& other) const {
+    OperationScope scope (Operation::Compare);
+
+    return lessThan (*this, other, true);
+  }
+
+  Bit Bits :: operator>= (const Bits& other) const {
+    return other.operator<= (*this);
+  }
+
+  Bit Bits :: operator> (const Bits& other) const {
+    return other.operator< (*this);
+  }
+
+  Bit Bits :: operator&& (const Bits& other) const {
+    Bits both (this->_bits);
+    both.add (other);
+    return both.all ();
+  }
+
+  Bit Bits :: operator|| (const Bits& other) const {
+    Bits both (this->_bits);
+    both.add (other);
+    return both.any ();
+  }
+
+  const Bit& Bits :: operator[] (size_t i) const {
+    return this->_bits [i];
+  }
+
+  size_t Bits :: size () const {
+    return this->_bits.size ();
+  }
+
+  void Bits :: add (const Bit& bit) {
+    this->_bits.push_back (bit);
+  }
+
+  void Bits :: add (const Bits& bits) {
+    for (const Bit& b : bits) {
+      this->add (b);
+    }
+  }
+
+  bool Bits :: hasValue () const {
+    return std::all_of (this->begin (), this->end (), [] (const Bit& b) {
+      return b.hasValue ();
+    });
+  }
+
+  std::vector <bool> Bits :: value () const {
+    assert (this->hasValue ());
+
+    std::vector <bool> result;
+    for (const Bit& b : *this) {
+      result.push_back (b.value ());
+    }
+    return result;
+  }
+
+  unsigned int Bits :: valueNat () const {
+    assert (this->hasValue ());
+    return fromBinary (this->value ());
+  }
+
+  Bits Bits :: negate () const {
+    std::vector <Bit> negBits;
+    for (const Bit& b : this->_bits) {
+      negBits.push_back (!b);
+    }
+    return Bits (negBits);
+  }
+
+  void Bits :: assertAny ()               const {        cppsat::assertAny (this->_bits);    }
+  void Bits :: assertAll ()               const {        cppsat::assertAll (this->_bits);    }
+  Bit  Bits :: all       ()               const { return cppsat::all       (this->_bits);    }
+  Bit  Bits :: any       ()               const { return cppsat::any       (this->_bits);    }
+  Bit  Bits :: none      ()               const { return cppsat::none      (this->_bits);    }
+  Bit  Bits :: atmost    (unsigned int k, CardinalityEncoding e) const {
+    return cppsat::atmost (k, this->_bits, e);
+  }
+  Bit  Bits :: exactly   (unsigned int k, CardinalityEncoding e) const {
+    return cppsat::exactly (k, this->_bits, e);
+  }
+
+  const std::vector <Bit>&          Bits :: vector () const { return this->_bits; }
+  std::vector <Bit>::iterator       Bits :: begin  ()       { return this->_bits.begin  (); }
+  std::vector <Bit>::const_iterator Bits :: begin  () const { return this->_bits.begin  (); }
+  std::vector <Bit>::const_iterator Bits :: cbegin () const { return this->_bits.cbegin (); }
+  std::vector <Bit>::iterator       Bits :: end    ()       { return this->_bits.end    (); }
+  std::vector <Bit>::const_iterator Bits :: end    () const { return this->_bits.end    (); }
+  std::vector <Bit>::const_iterator Bits :: cend   () const { return this->_bits.cend   (); }
+
+  void assertAll (const std::vector <Bit>& bits) {
+    for (const Bit& bit : bits) {
+      addClause (&bit, 1, true);
+    }
+  }
+
+  void assertAny (const std::vector <Bit>& bits) {
+    addClause (bits.data (), bits.size (), true);
+  }
+
+  Bit all (const std::vector <Bit>& bits) {
+    OperationScope scope (Operation::All);
+
+    if (std::any_of ( bits.begin (), bits.end ()
+                    , [] (const Bit& b) { return b.isConstant (false); } ))
+    {
+      return Bit (false);
+    }
+
+    // sorted and deduplicated inputs, so that the gate's key does not depend
+    // on the order or multiplicity of its inputs
+    std::vector <Bit> inputs;
+    inputs.reserve (bits.size ());
+    for (const Bit& bit : bits) {
+      if (bit.isConstant () == false) {
+        inputs.push_back (bit);
+      }
+    }
+    std::sort (inputs.begin (), inputs.end (), std::less <Bit> ());
+    inputs.erase ( std::unique (inputs.begin (), inputs.end (), std::equal_to <Bit> ())
+                 , inputs.end () );
+
+    for (size_t i = 1; i < inputs.size (); i++) {
+      if (inputs[i-1].literal () == (inputs[i].literal () ^ 1)) {
+        return Bit (false);
+      }
+    }
+
+    if (inputs.size () == 0) {
+      return Bit (true);
+    }
+    else if (inputs.size () == 1) {
+      return inputs.front ();
     }
     else {
+      GateKey key = { GateType::And, {} };
+      for (const Bit& input : inputs) {
+        key.inputs.push_back (input.literal ());
+      }
+
+      Context::State& s     = state ();
+      GateCache&      gates = s.gates;
+
+      auto it = gates.find (key);
+      s.statistics.gateLookups++;
+      if (it != gates.end ()) {
+        s.statistics.gateHits++;
+        return it->second;
+      }
+
       Bit result;
-      cppsat::assertAny ({ this->negate (), other          , result           });
-      cppsat::assertAny ({*this           , other.negate (), result           });
-      cppsat::assertAny ({*this           , other          , result.negate () });
-      cppsat::assertAny ({ this->negate (), other.negate (), result.negate () });
+      defineGate (GateType::And, key.inputs, result);
+
+      gates.emplace (std::move (key), result);
       return result;
     }
   }
 
-  Bit Bit :: ifThenElse  (const Bit& t, const Bit& f) const {
-    if (this->hasValue ()) {
-      return this->value () ? t : f;
+  Bit any (const std::vector <Bit>& bits) {
+    return Bits (bits).negate ().all ().negate ();
+  }
+
+  Bit none (const std::vector <Bit>& bits) {
+    return cppsat::any (bits).negate ();
+  }
+
+  Bit atmost (unsigned int k, const std::vector <Bit>& bits, CardinalityEncoding e) {
+    OperationScope scope (Operation::Atmost);
+
+    if (k == 0) {
+      return cppsat::none (bits);
+    }
+    else if (k >= bits.size ()) {
+      return Bit (true);
+    }
+    else {
+      const CardinalityEncoding encoding = chooseEncoding (k, bits.size (), e);
+
+      switch (encoding) {
+        case CardinalityEncoding::Pairwise:  return atmostOnePairwise  (bits);
+        case CardinalityEncoding::Commander: return atmostOneCommander (bits);
+        default:
+          return unaryCount (bits, k + 1, encoding)[k].negate ();
+      }
+    }
+  }
+
+  Bit exactly (unsigned int k, const std::vector <Bit>& bits, CardinalityEncoding e) {
+    OperationScope scope (Operation::Atmost);
+
+    if (k == 0) {
+      return cppsat::none (bits);
+    }
+    else if (k > bits.size ()) {
+      return Bit (false);
+    }
+    else if (k == bits.size ()) {
+      return cppsat::all (bits);
+    }
+    else {
+      const CardinalityEncoding encoding = chooseEncoding (k, bits.size (), e);
+
+      switch (encoding) {
+        case CardinalityEncoding::Pairwise:
+          return cppsat::any (bits) && atmostOnePairwise (bits);
+        case CardinalityEncoding::Commander:
+          return cppsat::any (bits) && atmostOneCommander (bits);
+        default: {
+          const std::vector <Bit> count = unaryCount (bits, k + 1, encoding);
+          return count[k-1] && count[k].negate ();
+        }
+      }
+    }
+  }
+
+  Bit pbLeq ( const std::vector <long>& weights, const std::vector <Bit>& bits, long bound
+            , PseudoBooleanEncoding e )
+  {
+    OperationScope scope (Operation::PseudoBoolean);
+
+    return pseudoBoolean (normalize (weights, bits, bound, false), e);
+  }
+
+  Bit pbGeq ( const std::vector <long>& weights, const std::vector <Bit>& bits, long bound
+            , PseudoBooleanEncoding e )
+  {
+    OperationScope scope (Operation::PseudoBoolean);
+
+    return pseudoBoolean (normalize (weights, bits, bound, true), e);
+  }
+
+  Bit pbEq ( const std::vector <long>& weights, const std::vector <Bit>& bits, long bound
+           , PseudoBooleanEncoding e )
+  {
+    return cppsat::pbLeq (weights, bits, bound, e) && cppsat::pbGeq (weights, bits, bound, e);
+  }
+
+  Bit allEqual (const std::vector <Bits>& bits) {
+    assert (bits.size () > 0);
+
+    return cppsat::forall ( bits.begin (), bits.end ()
+                          , [&bits] (const Bits& b)
+    {
+      return b == bits[0];
+    });
+  }
+
+  Bit allDifferent (const std::vector <Bits>& bits, AllDifferentEncoding e) {
+    size_t width = 0;
+    for (const Bits& b : bits) {
+      width = std::max (width, b.size ());
+    }
+
+    const size_t n = bits.size ();
+    const bool   isSmallDomain = width < 8 * sizeof (unsigned int) - 1;
+
+    // one-hot on larger domains than these would loop over too many values
+    const size_t maxOneHot = (e == AllDifferentEncoding::OneHot ? 64 : 2) * n;
+
+    if (isSmallDomain && n > (size_t (1) << width)) {
+      return Bit (false);
+    }
+    else if ( e != AllDifferentEncoding::Pairwise
+           && isSmallDomain && (size_t (1) << width) <= maxOneHot )
+    {
+      // every value is taken by at most one of the bits.  The indicators
+      // x == v are shared between all constraints over x.
+      std::vector <Bit> perValue;
+      for (unsigned int v = 0; v < (1u << width); v++) {
+        std::vector <Bit> takenBy;
+        for (const Bits& b : bits) {
+          takenBy.push_back (b == Bits (width, v));
+        }
+        perValue.push_back (cppsat::atmost (1, takenBy));
+      }
+      return cppsat::all (perValue);
+    }
+    else {
+      // every pair differs in some bit.  The per-bit exclusive-ors are
+      // shared with all other comparisons of the same bits.
+      std::vector <Bit> diffs;
+      for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+          diffs.push_back (bits[i] != bits[j]);
+        }
+      }
+      return cppsat::all (diffs);
+    }
+  }
+
+  bool solve () {
+    return cppsat::solve (std::vector <Bit> ());
+  }
+
+  bool solve (Bit bit) {
+    return cppsat::solve (std::vector <Bit> (1, bit));
+  }
+
+  bool solve (const std::vector <Bit>& assumptions) {
+    return cppsat::solveLimited (Budget (), assumptions) == Result::Sat;
+  }
+
+  Result solveLimited (const Budget& budget, const std::vector <Bit>& assumptions) {
+    Context::State& s = state ();
+    Stopwatch       stopwatch (s.statistics.solvingSeconds);
+    std::vector <int> lits;
+
+    // the solver is registered before the assumptions are encoded and
+    // before the watchdog starts, which then stops before the interrupt is
+    // cleared
+    Running running (s, { s.solver.get () });
+
+    if (assumptionLiterals (assumptions, lits) == false) {
+      return Result::Unsat;
+    }
+    Watchdog watchdog (Context::current (), budget.seconds);
+
+    const Result result = s.solver->solve (lits, budget);
+    if (result == Result::Sat) {
+      storeModel (*s.solver);
+    }
+    else if (result == Result::Unsat) {
+      computeCore (*s.solver, assumptions);
+    }
+    return result;
+  }
+
+  std::future <Result> solveAsync (const Budget& budget, const std::vector <Bit>& assumptions) {
+    Context& context = Context::current ();
+
+    return std::async (std::launch::async, [&context, budget, assumptions] () {
+      ContextScope scope (context);
+      return cppsat::solveLimited (budget, assumptions);
+    });
+  }
+
+  bool solvePortfolio (unsigned int threads, const std::vector <Bit>& assumptions) {
+    Context::State& s = state ();
+    if (s.logging == false) {
+      return cppsat::solve (assumptions);
+    }
+    Stopwatch       stopwatch (s.statistics.solvingSeconds);
+    std::vector <int> lits;
+
+    if (assumptionLiterals (assumptions, lits) == false) {
+      return false;
+    }
+    if (threads == 0) {
+      threads = std::max (1u, std::thread::hardware_concurrency ());
+    }
+
+    // The context's own solver takes part as first member, so that its
+    // learnt clauses are kept.  The others are loaded from the clause log.
+    std::vector <std::unique_ptr <Solver>> copies;
+    std::vector <Solver*> solvers { s.solver.get () };
+    for (unsigned int i = 1; i < threads; i++) {
+      copies.push_back (newSolver (s.backend));
+      solvers.push_back (copies.back ().get ());
+    }
+
+    std::atomic <int> winner (-1);
+    Result            result = Result::Unknown;
+    std::mutex        mutex;
+    std::vector <std::thread> workers;
+    Running           running (s, solvers);
+
+    for (unsigned int i = 0; i < threads; i++) {
+      workers.emplace_back ([&, i] () {
+        Solver& solver = *solvers[i];
+        if (i > 0) {
+          solver.diversify (i);
+          loadClauses (solver, s.clauses, s.solver->numVars ());
+        }
+        const Result r = solver.solve (lits, Budget ());
+        int none = -1;
+
+        if (r != Result::Unknown && winner.compare_exchange_strong (none, int (i))) {
+          std::lock_guard <std::mutex> lock (mutex);
+          result = r;
+          for (unsigned int j = 0; j < threads; j++) {
+            if (j != i) {
+              solvers[j]->interrupt ();
+            }
+          }
+        }
+      });
+    }
+    for (std::thread& worker : workers) {
+      worker.join ();
+    }
+
+    if (winner < 0) {
+      return false;
+    }
+    const Solver& best = *solvers[winner];
+    if (result == Result::Sat) {
+      storeModel (best);
+      return true;
     }
     else {
-      Bit result;
-      cppsat::assertAny ({ this->negate (), t.negate (), result           });
-      cppsat::assertAny ({ this->negate (), t          , result.negate () });
-      cppsat::assertAny ({*this           , f.negate (), result           });
-      cppsat::assertAny ({*this           , f          , result.negate () });
-      return result;
+      computeCore (best, assumptions);
+      return false;
     }
   }
 
-  Bits :: Bits () {}
-
-  Bits :: Bits (size_t s) 
-    : _bits (s) 
-  {}
-
-  Bits :: Bits (size_t s, unsigned int i) 
-    : Bits (toBinary (s, i))
-  {}
-
-  Bits :: Bits (const std::vector <Bit>& bits) 
-    : _bits (bits) 
-  {}
+  bool solveCubes (const std::vector <Bit>& split, unsigned int threads) {
+    std::vector <int> lits;
+    std::vector <int> literals;
 
-  Bits :: Bits (const std::vector <bool>& bits) {
-    for (bool b : bits) {
-      this->add (Bit (b));
+    if (state ().logging == false) {
+      return cppsat::solve ();
     }
+    assumptionLiterals ({}, lits);
+    for (const Bit& bit : split) {
+      if (bit.isConstant () == false && literals.size () < maxSplit) {
+        const int both[] = { bit.literal (), bit.literal () ^ 1 };
+        require (both, 2);
+        literals.push_back (bit.literal ());
+      }
+    }
+    return conquer (literals, threads, lits);
   }
 
-  Bits Bits :: operator! () const { return this->negate (); }
-
-  Bits Bits :: operator+ (const Bits& other) const {
-    Bits a (*this);
-    Bits b (other);
-    Bits result;
-
-    equalizeLength (a, b);
+  bool solveCubes (unsigned int depth, unsigned int threads) {
+    std::vector <int> lits;
 
-    std::function <Bit (size_t, const Bit&)> go = [&go, &a, &b, &result]
-                                                  (size_t i, const Bit& carry)
-    {
-      if (i < a.size ()) {
-        BitPair r = fullAdder (a[i], b[i], carry);
+    if (state ().logging == false) {
+      return cppsat::solve ();
+    }
+    assumptionLiterals ({}, lits);
+    return conquer (lookahead (unsigned (std::min (size_t (depth), maxSplit)), lits), threads, lits);
+  }
 
-        result.add (r.first);
-        return go (i + 1, r.second);
-      }
-      else {
-        return carry;
-      }
-    };
-    cppsat::assertAny ({ ! go (0, Bit (false)) });
-    return result;
+  const std::vector <Bit>& core () {
+    return state ().core;
   }
 
-  Bits Bits :: operator* (const Bits& other) const {
-    Bits a (*this);
-    Bits b (other);
+  void push () {
+    state ().scopes.push_back (Bit ());
+  }
 
-    equalizeLength (a, b);
+  void pop () {
+    std::vector <Bit>& scopes = state ().scopes;
+    assert (scopes.empty () == false);
 
-    std::vector <std::vector <Bit>> weights;
-    weights.resize ((a.size () * 2) - 1);
+    // disables every clause that has been asserted in this scope
+    const Bit disable = scopes.back ().negate ();
+    addClause (&disable, 1, false);
+    scopes.pop_back ();
+  }
 
-    auto isReducable = [&weights] () {
-      for (const std::vector <Bit>& ws : weights) {
-        if (ws.size () > 2) {
-          return true;
-        }
-      }
+  bool minimize (const Bits& objective, OptimizationStrategy strategy) {
+    if (cppsat::solve () == false) {
       return false;
-    };
-    auto reduce = [&weights] () {
-      for (int i = weights.size () - 1; i >= 0; i--) {
-        const size_t numW = weights[i].size ();
+    }
 
-        if (numW == 1) {
-          continue;
+    // `best` is the value of the best model so far.  Bounds are passed as
+    // assumptions, so that the solver keeps its learned clauses between the
+    // steps and the problem is left unchanged.
+    std::vector <bool> best        = objective.value ();
+    bool               modelIsBest = true;
+
+    switch (strategy) {
+      case OptimizationStrategy::Linear:
+        for (;;) {
+          if (cppsat::solve ({ objective < Bits (best) })) {
+            best = objective.value ();
+          }
+          else {
+            modelIsBest = false;
+            break;
+          }
         }
-        else if (numW == 2) {
-          BitPair r = halfAdder (weights[i][0], weights[i][1]);
-          weights[i].clear ();
-          weights[i].push_back (r.first);
+        break;
+
+      case OptimizationStrategy::Binary: {
+        std::vector <bool> lower (best.size (), false);
 
-          if (weights.size () == (unsigned int)(i + 1)) {
-            weights.resize (weights.size () + 1);
+        while (lessThan (lower, best)) {
+          const std::vector <bool> middle = average (lower, best);
+
+          if (cppsat::solve ({ objective <= Bits (middle) })) {
+            best        = objective.value ();
+            modelIsBest = true;
           }
-          weights[i+1].push_back (r.second);
-        }
-        else if (numW >= 3) {
-          BitPair r = fullAdder ( weights[i][numW - 1]
-                                , weights[i][numW - 2]
-                                , weights[i][numW - 3] );
-          weights[i].pop_back ();
-          weights[i].pop_back ();
-          weights[i].pop_back ();
-          weights[i].push_back (r.first);
-
-          if (weights.size () == (unsigned int) (i + 1)) {
-            weights.resize (weights.size () + 1);
+          else {
+            lower       = increment (middle);
+            modelIsBest = false;
           }
-          weights[i+1].push_back (r.second);
         }
+        break;
       }
-    };
-    auto add = [&weights] () {
-      Bits result;
-      std::function <Bit (size_t, const Bit&)> go = [&go, &result, &weights] 
-                                                    (size_t i, const Bit& carry)
-      {
-        if (i >= weights.size ()) {
-          return carry;
-        }
-        else {
-          assert (weights[i].size () == 1 || weights[i].size () == 2);
 
-          BitPair r = fullAdder ( weights[i][0]
-                                , weights[i].size () == 1 ? Bit (false)
-                                                          : weights[i][1]
-                                , carry );
-          result.add (r.first);
-          return go (i + 1, r.second);
+      case OptimizationStrategy::Lexicographic: {
+        // fixes the bits from the most significant one downwards, each one
+        // to false if possible
+        std::vector <Bit> prefix;
+
+        for (size_t i = objective.size (); i > 0; i--) {
+          const Bit& bit = objective[i-1];
+
+          if (best[i-1]) {
+            std::vector <Bit> assumptions (prefix);
+            assumptions.push_back (bit.negate ());
+
+            if (cppsat::solve (assumptions)) {
+              best        = objective.value ();
+              modelIsBest = true;
+            }
+            else {
+              modelIsBest = false;
+            }
+          }
+          prefix.push_back (best[i-1] ? bit : bit.negate ());
         }
-      };
-      cppsat::assertAny ({ ! go (0, Bit (false)) });
-      return result;
-    };
-
-    for (size_t i = 0; i < a.size (); i++) {
-      for (size_t j = 0; j < b.size (); j++) {
-        weights[i+j].push_back (a[i] && b[j]);
+        break;
       }
     }
-    while (isReducable ()) {
-      reduce ();
+
+    if (modelIsBest == false) {
+      const bool isSat = cppsat::solve ({ objective == Bits (best) });
+      assert (isSat);
+      (void) isSat;
     }
+    return true;
+  }
 
-    Bits fullResult = add ();
-    Bits result;
+  bool maximize (const Bits& objective, OptimizationStrategy strategy) {
+    return cppsat::minimize (objective.negate (), strategy);
+  }
 
-    for (size_t i = 0; i < fullResult.size (); i++) {
-      if (i < a.size ()) {
-        result.add (fullResult[i]);
+  size_t enumerate ( const Bits& projection
+                   , const std::function <bool (const std::vector <bool>&)>& callback
+                   , size_t limit )
+  {
+    std::vector <bool> values (projection.size ());
+    std::vector <Bit>  blocking;
+    size_t             count = 0;
+
+    // blocking clauses live in their own scope, so that the enumeration
+    // leaves the problem as it was
+    cppsat::push ();
+    while ((limit == 0 || count < limit) && cppsat::solve ()) {
+      blocking.clear ();
+
+      for (size_t i = 0; i < projection.size (); i++) {
+        values[i] = projection[i].value ();
+
+        if (projection[i].isConstant () == false) {
+          blocking.push_back (values[i] ? projection[i].negate () : projection[i]);
+        }
       }
-      else {
-        cppsat::assertAny ({ ! fullResult[i] });
+      count++;
+
+      if (callback (values) == false || blocking.empty ()) {
+        break;
       }
+      cppsat::assertAny (blocking);
     }
-    return result;
+    cppsat::pop ();
+    return count;
   }
 
-  Bit Bits :: operator== (const Bits& other) const {
-    BitPair r = compare (*this, other);
+  void simplify (const std::vector <Bits>& keep) {
+    Context::State&   s = state ();
+    std::vector <int> frozen;
 
-    return !r.first && r.second;
-  }
+    for (const Bit& scope : s.scopes) {
+      frozen.push_back (scope.literal ());
+    }
+    for (const auto& entry : s.names) {
+      for (const Bit& bit : entry.second) {
+        if (bit.isConstant () == false) {
+          frozen.push_back (bit.literal ());
+        }
+      }
+    }
+    for (const Bits& bits : keep) {
+      for (const Bit& bit : bits) {
+        if (bit.isConstant () == false) {
+          frozen.push_back (bit.literal ());
+        }
+      }
+    }
 
-  Bit Bits :: operator!= (const Bits& other) const {
-    return this->operator== (other).negate ();
-  }
+    // Frozen gates get both directions, so that no clause over an
+    // eliminated input is needed later on
+    for (size_t i = 0, n = frozen.size (); i < n; i++) {
+      frozen.push_back (frozen[i] ^ 1);
+    }
+    require (frozen.data (), frozen.size ());
 
-  Bit Bits :: operator< (const Bits& other) const {
-    BitPair r = compare (*this, other);
+    for (int& literal : frozen) {
+      literal >>= 1;
+    }
+    s.solver->simplify (frozen);
 
-    return r.first && !r.second;
-  }
+    // Gates over eliminated variables must not be handed out again.  Their
+    // definitions stay, such that their outputs can still be evaluated.
+    for (auto it = s.gates.begin (); it != s.gates.end (); ) {
+      const bool isEliminated =
+           s.solver->isEliminated (it->second.literal () >> 1)
+        || std::any_of ( it->first.inputs.begin (), it->first.inputs.end ()
+                       , [&s] (int literal) { return s.solver->isEliminated (literal >> 1); } );
 
-  Bit Bits :: operator<= (const Bits& other) const {
-    BitPair r = compare (*this, other);
+      it = isEliminated ? s.gates.erase (it) : std::next (it);
+    }
+  }
 
-    return r.first || r.second;
+  void reset () {
+    state ().model.clear ();
+    state ().evaluated.clear ();
   }
 
-  Bit Bits :: operator>= (const Bits& other) const {
-    return other.operator<= (*this);
+  void setEncoding (Encoding encoding) {
+    state ().encoding = encoding;
   }
 
-  Bit Bits :: operator> (const Bits& other) const {
-    return other.operator< (*this);
+  void printStatistics () {
+    const Statistics statistics = cppsat::statistics ();
+    const char*      operations[] = { "all", "equalsNot", "ifThenElse", "add"
+                                    , "multiply", "compare", "atmost", "shift"
+                                    , "divide", "pseudoBoolean" };
+
+    auto print = [] (const std::string& name, const Counts& counts) {
+      std::cerr << name << ": #variables: " << counts.variables
+                        << ", #clauses: "   << counts.clauses
+                        << ", seconds: "    << counts.seconds
+                        << std::endl;
+    };
+
+    state ().solver->printStatistics (std::cerr);
+    std::cerr << "#gate lookups: "      << statistics.gateLookups
+              << ", #gate hits: "       << statistics.gateHits
+              << ", encoding seconds: " << statistics.encodingSeconds
+              << ", solving seconds: "  << statistics.solvingSeconds
+              << std::endl;
+    for (const auto& entry : statistics.operations) {
+      print (operations[int (entry.first)], entry.second);
+    }
+    for (const auto& entry : statistics.labels) {
+      print (entry.first, entry.second);
+    }
   }
 
-  Bit Bits :: operator&& (const Bits& other) const {
-    Bits both (this->_bits);
-    both.add (other);
-    return both.all ();
+  Statistics statistics () {
+    const Context::State& s      = state ();
+    Statistics            result = s.statistics;
+
+    result.variables = s.solver->numVars ();
+    s.solver->counters (result);
+    return result;
   }
 
-  Bit Bits :: operator|| (const Bits& other) const {
-    Bits both (this->_bits);
-    both.add (other);
-    return both.any ();
+  void instrument (bool instrumented) {
+    state ().instrumented = instrumented;
   }
 
-  const Bit& Bits :: operator[] (size_t i) const {
-    return this->_bits [i];
+  StatisticsLabel :: StatisticsLabel (const std::string& name)
+    : _name      (name)
+    , _variables (state ().solver->numVars ())
+    , _clauses   (state ().statistics.clauses)
+    , _start     (now ())
+  {}
+
+  StatisticsLabel :: ~StatisticsLabel () {
+    Context::State& s      = state ();
+    Counts&         counts = s.statistics.labels[this->_name];
+
+    counts.variables += s.solver->numVars () - this->_variables;
+    counts.clauses   += s.statistics.clauses - this->_clauses;
+    counts.seconds   += now () - this->_start;
   }
 
-  size_t Bits :: size () const {
-    return this->_bits.size ();
+  void name (const Bit& bit, const std::string& symbol) {
+    name (Bits ({ bit }), symbol);
   }
 
-  void Bits :: add (const Bit& bit) {
-    this->_bits.push_back (bit);
+  void name (const Bits& bits, const std::string& symbol) {
+    state ().names.push_back ({ symbol, bits });
   }
 
-  void Bits :: add (const Bits& bits) {
-    for (const Bit& b : bits) {
-      this->add (b);
+  bool logClauses () {
+    Context::State& s = state ();
+    if (s.statistics.clauses == 0) {
+      s.logging = true;
     }
+    return s.logging;
   }
 
-  bool Bits :: hasValue () const {
-    return std::all_of (this->begin (), this->end (), [] (const Bit& b) {
-      return b.hasValue ();
-    });
-  }
+  bool writeDimacs (std::ostream& os) {
+    Context::State& s = state ();
+    closeDimacs ();
 
-  std::vector <bool> Bits :: value () const {
-    assert (this->hasValue ());
+    if (s.logging == false) {
+      return false;
+    }
 
-    std::vector <bool> result;
-    for (const Bit& b : *this) {
-      result.push_back (b.value ());
+    // Later clauses are only streamed if the header can be patched when the
+    // stream is closed.  Otherwise the header counts the clauses up to now.
+    size_t logged = 0;
+    for (size_t i = 0; i < s.clauses.size (); i += s.clauses[i] + 1) {
+      logged++;
     }
-    return result;
-  }
 
-  unsigned int Bits :: valueNat () const {
-    assert (this->hasValue ());
-    return fromBinary (this->value ());
-  }
+    s.dimacs        = &os;
+    s.dimacsHeader  = os.tellp ();
+    s.dimacsStream  = s.dimacsHeader != std::streampos (-1);
+    s.dimacsClauses = logged;
+    printDimacsHeader (s);
+    s.dimacsClauses = 0;
 
-  Bits Bits :: negate () const {
-    std::vector <Bit> negBits;
-    for (const Bit& b : this->_bits) {
-      negBits.push_back (!b);
+    for (size_t i = 0; i < s.clauses.size (); i += s.clauses[i] + 1) {
+      printDimacsClause (s, &s.clauses[i + 1], s.clauses[i]);
     }
-    return Bits (negBits);
+    return true;
   }
 
-  void Bits :: assertAny ()               const {        cppsat::assertAny (this->_bits);    }
-  void Bits :: assertAll ()               const {        cppsat::assertAll (this->_bits);    }
-  Bit  Bits :: all       ()               const { return cppsat::all       (this->_bits);    }
-  Bit  Bits :: any       ()               const { return cppsat::any       (this->_bits);    }
-  Bit  Bits :: none      ()               const { return cppsat::none      (this->_bits);    }
-  Bit  Bits :: atmost    (unsigned int k) const { return cppsat::atmost    (k, this->_bits); }
-  Bit  Bits :: exactly   (unsigned int k) const { return cppsat::exactly   (k, this->_bits); }
+  void closeDimacs () {
+    Context::State& s = state ();
+    if (s.dimacs == nullptr) {
+      return;
+    }
 
-  const std::vector <Bit>&          Bits :: vector () const { return this->_bits; }
-  std::vector <Bit>::iterator       Bits :: begin  ()       { return this->_bits.begin  (); }
-  std::vector <Bit>::const_iterator Bits :: begin  () const { return this->_bits.begin  (); }
-  std::vector <Bit>::const_iterator Bits :: cbegin () const { return this->_bits.cbegin (); }
-  std::vector <Bit>::iterator       Bits :: end    ()       { return this->_bits.end    (); }
-  std::vector <Bit>::const_iterator Bits :: end    () const { return this->_bits.end    (); }
-  std::vector <Bit>::const_iterator Bits :: cend   () const { return this->_bits.cend   (); }
+    for (const auto& entry : s.names) {
+      *s.dimacs << "c bits " << entry.first;
+      for (const Bit& bit : entry.second) {
+        if (bit.isConstant ()) {
+          *s.dimacs << (bit.value () ? " true" : " false");
+        }
+        else {
+          *s.dimacs << ' ' << toDimacs (bit.literal ());
+        }
+      }
+      *s.dimacs << '\n';
+    }
 
-  void assertAll (const std::vector <Bit>& bits) {
-    for (const Bit& bit : bits) {
-      cppsat::assertAny ({ bit });
+    if (s.dimacsStream) {
+      const std::streampos end = s.dimacs->tellp ();
+      s.dimacs->seekp (s.dimacsHeader);
+      printDimacsHeader (s);
+      s.dimacs->seekp (end);
     }
+    s.dimacs->flush ();
+    s.dimacs       = nullptr;
+    s.dimacsStream = false;
   }
 
-  void assertAny (const std::vector <Bit>& bits) {
-    if (std::none_of ( bits.begin (), bits.end ()
-                     , [] (const Bit& b) { return b.hasValue (true); } ))
-    {
-      Minisat::vec <Minisat::Lit> vec;
-      vec.capacity (bits.size ());
+  Bits readDimacs (const std::string& file) {
+    Context::State& s = state ();
+    Bits            variables;
+    struct stat     info;
+    const int       fd = open (file.c_str (), O_RDONLY);
 
-      for (const Bit& bit : bits) {
-        if (bit.hasValue () == false) {
-          vec.push (toMinisatLit (bit));
-        }
+    if (fd < 0 || fstat (fd, &info) != 0) {
+      std::cerr << "cppsat: cannot read " << file << std::endl;
+      if (fd >= 0) {
+        close (fd);
       }
-      solver.addClause (vec);
+      return variables;
     }
-  }
 
-  Bit all (const std::vector <Bit>& bits) {
-    if (bits.size () == 0) {
-      return Bit (true);
+    const size_t size = size_t (info.st_size);
+    void* const  data = size > 0 ? mmap (nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                                 : nullptr;
+    close (fd);
+    if (data == MAP_FAILED) {
+      std::cerr << "cppsat: cannot map " << file << std::endl;
+      return variables;
     }
-    else if (bits.size () == 1) {
-      return *bits.begin ();
+
+    const char*       p   = static_cast <const char*> (data);
+    const char* const end = p + size;
+    std::vector <int> clause;
+
+    auto flush = [&s, &clause] () {
+      if (s.scopes.empty () == false) {
+        clause.push_back (s.scopes.back ().negate ().literal ());
+      }
+      emitClause (clause.data (), clause.size ());
+      clause.clear ();
+    };
+
+    while (p < end) {
+      if (*p == 'c' || *p == 'p') {
+        while (p < end && *p != '\n') {
+          p++;
+        }
+      }
+      else if (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+        p++;
+      }
+      else if (*p == '-' || (*p >= '0' && *p <= '9')) {
+        const bool negative = *p == '-';
+        size_t     var      = 0;
+
+        for (p += negative ? 1 : 0; p < end && *p >= '0' && *p <= '9'; p++) {
+          var = 10 * var + size_t (*p - '0');
+        }
+        if (var == 0) {
+          flush ();
+        }
+        else {
+          while (variables.size () < var) {
+            variables.add (Bit ());
+          }
+          clause.push_back (variables[var - 1].literal () ^ (negative ? 1 : 0));
+        }
+      }
+      else if (*p == '%') {
+        break;
+      }
+      else {
+        std::cerr << "cppsat: unexpected character in " << file << std::endl;
+        break;
+      }
     }
-    else if (std::any_of ( bits.begin (), bits.end ()
-                         , [] (const Bit& b) { return b.hasValue (false); } ))
-    {
-      return Bit (false);
+    if (clause.empty () == false) {
+      flush ();
     }
-    else if (std::all_of ( bits.begin (), bits.end ()
-                         , [] (const Bit& b) { return b.hasValue (true); } ))
-    {
-      return Bit (true);
+    if (data) {
+      munmap (data, size);
     }
-    else {
-      Bit result;
-      for (const Bit& bit : bits) {
-        cppsat::assertAny ({ result.negate (), bit }); 
-      }
-      std::vector <Bit> negBits (Bits (bits).negate ().vector ());
-      negBits.push_back (result);
-      cppsat::assertAny (negBits);
+    return variables;
+  }
 
-      return result;
+  bool writeSnapshot (std::ostream& os) {
+    const Context::State& s = state ();
+
+    // clauses of open scopes would be written without their guards
+    if (s.logging == false || s.scopes.empty () == false) {
+      return false;
     }
-  }
 
-  Bit any (const std::vector <Bit>& bits) {
-    return Bits (bits).negate ().all ().negate ();
-  }
+    std::vector <int> data (sizeof (SnapshotHeader) / sizeof (int));
+    SnapshotHeader    header;
+
+    header.magic   = snapshotMagic;
+    header.numVars = s.solver->numVars ();
+    header.clauses = int (s.clauses.size ());
+    data.insert (data.end (), s.clauses.begin (), s.clauses.end ());
+
+    const size_t definitions = data.size ();
+    for (const Gate& gate : s.definitions) {
+      data.push_back (int (gate.type));
+      data.push_back ((gate.positive ? 1 : 0) | (gate.negative ? 2 : 0));
+      data.push_back (gate.output);
+      data.push_back (int (gate.inputs.size ()));
+      data.insert (data.end (), gate.inputs.begin (), gate.inputs.end ());
+    }
+    header.definitions = int (data.size () - definitions);
 
-  Bit none (const std::vector <Bit>& bits) {
-    return cppsat::any (bits).negate ();
-  }
+    const size_t names = data.size ();
+    for (const auto& entry : s.names) {
+      const std::string& symbol = entry.first;
+      const size_t       chars  = data.size () + 2;
 
-  Bit atmost (unsigned int k, const std::vector <Bit>& bits) {
-    if (k == 0) {
-      return cppsat::none (bits);
+      data.push_back (int (symbol.size ()));
+      data.push_back (int (entry.second.size ()));
+      data.resize (chars + (symbol.size () + sizeof (int) - 1) / sizeof (int), 0);
+      std::copy (symbol.begin (), symbol.end (), reinterpret_cast <char*> (&data[chars]));
+
+      for (const Bit& bit : entry.second) {
+        data.push_back (bit.isConstant () ? (bit.value () ? snapshotTrue : snapshotFalse)
+                                          : bit.literal ());
+      }
     }
-    else if (bits.empty ()) {
-      return Bit (true);
+    header.names = int (data.size () - names);
+
+    std::memcpy (data.data (), &header, sizeof (header));
+    os.write (reinterpret_cast <const char*> (data.data ()), data.size () * sizeof (int));
+    os.flush ();
+    return true;
+  }
+
+  bool readSnapshot (const std::string& file) {
+    Context::State& s = state ();
+    struct stat     info;
+    if (s.scopes.empty () == false) {
+      return false;
     }
-    else {
-      const Bit&              firstBit (bits.front ());
-      const std::vector <Bit> lessBits (++bits.begin (), bits.end ());
+    const int       fd = open (file.c_str (), O_RDONLY);
 
-      return (firstBit.negate () && cppsat::atmost (k  , lessBits)) 
-          || (firstBit           && cppsat::atmost (k-1, lessBits));
+    if (fd < 0 || fstat (fd, &info) != 0) {
+      std::cerr << "cppsat: cannot read " << file << std::endl;
+      if (fd >= 0) {
+        close (fd);
+      }
+      return false;
     }
-  }
 
-  Bit exactly (unsigned int k, const std::vector <Bit>& bits) {
-    if (k == 0) {
-      return cppsat::none (bits);
+    const size_t size = size_t (info.st_size);
+    void* const  data = size > 0 ? mmap (nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                                 : MAP_FAILED;
+    close (fd);
+    if (data == MAP_FAILED) {
+      std::cerr << "cppsat: cannot map " << file << std::endl;
+      return false;
     }
-    else if (bits.empty ()) {
-      return Bit (false);
+
+    const int* const p = static_cast <const int*> (data);
+    SnapshotHeader   header;
+
+    if (size < sizeof (header)) {
+      header.magic = 0;
     }
     else {
-      const Bit&              firstBit (bits.front ());
-      const std::vector <Bit> lessBits (++bits.begin (), bits.end ());
+      std::memcpy (&header, p, sizeof (header));
+    }
+    const size_t words = sizeof (header) / sizeof (int) + size_t (header.clauses)
+                       + size_t (header.definitions) + size_t (header.names);
+
+    if (header.magic != snapshotMagic || size != words * sizeof (int)) {
+      std::cerr << "cppsat: " << file << " is not a snapshot" << std::endl;
+      munmap (data, size);
+      return false;
+    }
 
-      return (firstBit.negate () && cppsat::exactly (k  , lessBits)) 
-          || (firstBit           && cppsat::exactly (k-1, lessBits));
+    // The snapshot's variables are appended to the ones of the context
+    const int         offset = 2 * s.solver->numVars ();
+    std::vector <Bit> vars;
+    vars.reserve (header.numVars);
+    for (int i = 0; i < header.numVars; i++) {
+      vars.push_back (Bit ());
     }
-  }
 
-  Bit allEqual (const std::vector <Bits>& bits) {
-    assert (bits.size () > 0);
+    auto literal = [&vars] (int l) {
+      return (l & 1) ? vars[l >> 1].negate () : vars[l >> 1];
+    };
 
-    return cppsat::forall ( bits.begin (), bits.end ()
-                          , [&bits] (const Bits& b)
-    {
-      return b == bits[0];
-    });
-  }
+    const int* clauses = p + sizeof (header) / sizeof (int);
+    if (offset == 0) {
+      emitClauses (clauses, header.clauses);
+    }
+    else {
+      std::vector <int> shifted (clauses, clauses + header.clauses);
+      for (int i = 0; i < header.clauses; i += clauses[i] + 1) {
+        for (int j = 1; j <= clauses[i]; j++) {
+          shifted[i + j] += offset;
+        }
+      }
+      emitClauses (shifted.data (), shifted.size ());
+    }
 
-  Bit allDifferent (const std::vector <Bits>& bits) {
-    Bits diffs;
-    for (size_t i = 0; i < bits.size () - 1; i++) {
-      for (size_t j = i + 1; j < bits.size (); j++) {
-        diffs.add (bits[i] != bits[j]);
+    const int* definitions = clauses + header.clauses;
+    for (int i = 0; i < header.definitions; i += definitions[i + 3] + 4) {
+      Gate gate;
+      gate.type     = GateType (definitions[i]);
+      gate.positive = (definitions[i + 1] & 1) != 0;
+      gate.negative = (definitions[i + 1] & 2) != 0;
+      gate.output   = definitions[i + 2] + offset;
+      for (int j = 0; j < definitions[i + 3]; j++) {
+        gate.inputs.push_back (definitions[i + 4 + j] + offset);
+      }
+
+      const size_t var = gate.output >> 1;
+      if (s.definitionOf.size () <= var) {
+        s.definitionOf.resize (var + 1, -1);
       }
+      s.definitionOf[var] = s.definitions.size ();
+      s.gates.emplace (GateKey { gate.type, gate.inputs }, literal (gate.output - offset));
+      s.definitions.push_back (std::move (gate));
     }
-    return diffs.all ();
-  }
 
-  bool solve () {
-    return solver.solve ();
-  }
+    const int* names = definitions + header.definitions;
+    for (int i = 0; i < header.names; ) {
+      const int   chars = names[i];
+      const int   width = names[i + 1];
+      const char* first = reinterpret_cast <const char*> (names + i + 2);
+      Bits        bits;
+
+      i += 2 + int ((chars + sizeof (int) - 1) / sizeof (int));
+      for (int j = 0; j < width; j++, i++) {
+        bits.add (names[i] == snapshotTrue  ? Bit (true)
+                : names[i] == snapshotFalse ? Bit (false)
+                                            : literal (names[i]));
+      }
+      s.names.push_back ({ std::string (first, chars), bits });
+    }
 
-  bool solve (Bit bit) {
-    cppsat::assertAny ({ bit });
-    return cppsat::solve ();
+    munmap (data, size);
+    return true;
   }
 
-  void reset () {
-    solver.model.clear ();
-  }
+  Bits named (const std::string& symbol) {
+    const auto& names = state ().names;
 
-  void printStatistics () {
-    std::cerr << "#variables: "  << solver.nVars ()
-              << ", #clauses: "  << solver.nClauses ()
-              << ", #literals: " << solver.clauses_literals
-              << std::endl;
+    for (auto it = names.rbegin (); it != names.rend (); ++it) {
+      if (it->first == symbol) {
+        return it->second;
+      }
+    }
+    return Bits ();
   }
 }
 
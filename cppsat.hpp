@@ -1,11 +1,155 @@
 #ifndef CPPSAT
 #define CPPSAT
 
+#include <functional>
+#include <future>
 #include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace cppsat {
 
+  // Pairwise and Commander only apply to a bound of one and are replaced
+  // by the automatic choice otherwise
+  enum class CardinalityEncoding { Auto
+                                 , Pairwise
+                                 , Commander
+                                 , SequentialCounter
+                                 , Totalizer
+                                 , SortingNetwork
+                                 };
+
+  enum class MultiplierEncoding { Dadda, Wallace, Booth };
+
+  // OneHot falls back to Pairwise on domains of more than 64 values per
+  // number, and Auto chooses OneHot up to 2 values per number
+  enum class AllDifferentEncoding { Auto, Pairwise, OneHot };
+
+  enum class PseudoBooleanEncoding { Auto, Bdd, Adder, SortingNetwork };
+
+  enum class OptimizationStrategy { Linear, Binary, Lexicographic };
+
+  enum class Operation { All, EqualsNot, IfThenElse, Add, Multiply, Compare, Atmost
+                       , Shift, Divide, PseudoBoolean };
+
+  // What has been encoded by an operation or under a label
+  struct Counts {
+    size_t variables = 0;
+    size_t clauses   = 0;
+    double seconds   = 0;
+  };
+
+  enum class Result { Sat, Unsat, Unknown };
+
+  // Limits of a solve call, of which negative ones are unlimited.  Backends
+  // without search counters only keep to the time limit.
+  struct Budget {
+    long   conflicts    = -1;
+    long   propagations = -1;
+    double seconds      = -1;
+  };
+
+  // Size of the formula that cppsat has emitted to the current context and
+  // the work spent on it.  Operations are only measured when instrumented.
+  // An operation counts everything encoded by it, but not when it is part
+  // of another operation, while labels count everything encoded under them.
+  struct Statistics {
+    size_t variables        = 0;
+    size_t clauses          = 0;
+    size_t literals         = 0;
+
+    size_t gateLookups      = 0;
+    size_t gateHits         = 0;
+
+    double encodingSeconds  = 0;
+    double solvingSeconds   = 0;
+
+    size_t conflicts        = 0;
+    size_t decisions        = 0;
+    size_t propagations     = 0;
+    size_t restarts         = 0;
+    size_t learnts          = 0;
+
+    std::map <Operation, Counts>   operations;
+    std::map <std::string, Counts> labels;
+  };
+
+  // Attributes everything encoded in the current context during its
+  // lifetime to a label of the statistics
+  class StatisticsLabel {
+    public:
+      explicit StatisticsLabel (const std::string&);
+              ~StatisticsLabel ();
+
+      StatisticsLabel            (const StatisticsLabel&) = delete;
+      StatisticsLabel& operator= (const StatisticsLabel&) = delete;
+
+    private:
+      std::string _name;
+      size_t      _variables;
+      size_t      _clauses;
+      double      _start;
+  };
+
+  // Tseitin emits both directions of every gate definition, Plaisted-Greenbaum
+  // only the directions that the polarities of the gate's uses require
+  enum class Encoding { Tseitin, PlaistedGreenbaum };
+
+  // MinisatSimp is Minisat with variable elimination and subsumption, which
+  // run on simplify.  Ipasir is any solver implementing the IPASIR interface
+  // that is linked in when cppsat is compiled with CPPSAT_IPASIR.
+  enum class Backend { Minisat, MinisatSimp, Ipasir };
+
+  // A context owns a solver, its variables and its gate cache.  Bits belong
+  // to the context that is current in their thread when they are created and
+  // must only be used while that context is current.  Without a ContextScope
+  // the current context is a process-wide default context.
+  class Context {
+    public:
+      struct State;
+
+      explicit Context  (Backend = Backend::Minisat);
+              ~Context ();
+
+      Context            (const Context&) = delete;
+      Context& operator= (const Context&) = delete;
+
+      State& state ();
+
+      // Stops the solve call that is running in this context, which then
+      // returns Unknown, or false if it returns a bool.  If no solver runs
+      // yet, the interrupt stops the next one.  It may be called from any
+      // thread.
+      void interrupt ();
+
+      static Context& current ();
+
+    private:
+      std::unique_ptr <State> _state;
+  };
+
+  // Makes a context the current context of this thread for its lifetime
+  class ContextScope {
+    public:
+      explicit ContextScope (Context&);
+              ~ContextScope ();
+
+      ContextScope            (const ContextScope&) = delete;
+      ContextScope& operator= (const ContextScope&) = delete;
+
+    private:
+      Context* _previous;
+  };
+
+  // A bit is a single literal.  Its negation flips the lowest bit, and the
+  // two constants are the reserved literals -2 (false) and -1 (true), so
+  // that negation works alike for both.  Bits compare with == to a new bit,
+  // so containers order, hash and compare them by std::less, std::hash and
+  // std::equal_to.  Only constants are folded when gates are built, while
+  // hasValue tells whether a bit has a value in the model of the last solve.
   class Bit {
     public:
                Bit ();
@@ -18,6 +162,7 @@ namespace cppsat {
       Bit  operator!= (const Bit&) const;
 
       bool isConstant  () const;
+      bool isConstant  (bool) const;
       int  literal     () const;
       bool hasValue    () const;
       bool hasValue    (bool) const;
@@ -31,10 +176,17 @@ namespace cppsat {
     private:
       explicit Bit (int);
 
-      const bool _isConstant;
-      const int  _value;
+      friend struct std::hash     <Bit>;
+      friend struct std::less     <Bit>;
+      friend struct std::equal_to <Bit>;
+
+      int _literal;
   };
 
+  // Bits are numbers with the least significant bit first.  The arithmetic
+  // operators treat them as unsigned and assert that their results do not
+  // overflow, except for the unary minus, which is signed.  The results of
+  // binary operations are as wide as the wider operand.
   class Bits {
     public:
       Bits ();
@@ -45,7 +197,15 @@ namespace cppsat {
 
             Bits operator!  () const;
             Bits operator+  (const Bits&) const;
+            Bits operator-  (const Bits&) const;
             Bits operator*  (const Bits&) const;
+            Bits operator/  (const Bits&) const;
+            Bits operator%  (const Bits&) const;
+            Bits operator-  () const;
+            Bits operator<< (size_t) const;
+            Bits operator<< (const Bits&) const;
+            Bits operator>> (size_t) const;
+            Bits operator>> (const Bits&) const;
             Bit  operator== (const Bits&) const;
             Bit  operator!= (const Bits&) const;
             Bit  operator<  (const Bits&) const;
@@ -64,13 +224,43 @@ namespace cppsat {
       unsigned int       valueNat  () const;
 
       Bits               negate    () const;
+
+      Bits               multiplyFull (const Bits&, MultiplierEncoding =
+                                                     MultiplierEncoding::Dadda) const;
+
+      std::pair <Bits, Bit> addWithCarry       (const Bits&, const Bit&) const;
+      std::pair <Bits, Bit> subtractWithBorrow (const Bits&, const Bit&) const;
+
+      // Wrap-around variants, whose results are taken modulo 2^width.  A
+      // division by zero yields all ones and the dividend as remainder.
+      Bits               addWrap        (const Bits&) const;
+      Bits               subtractWrap   (const Bits&) const;
+      Bits               multiplyWrap   (const Bits&) const;
+      Bits               twosComplement () const;
+      Bits               shiftLeftWrap  (size_t) const;
+      Bits               shiftLeftWrap  (const Bits&) const;
+      std::pair <Bits, Bits> divMod     (const Bits&) const;
+
+      // Two's complement variants.  Narrower operands are sign-extended and
+      // addSigned and subtractSigned assert that they do not overflow.
+      Bits               addSigned            (const Bits&) const;
+      Bits               subtractSigned       (const Bits&) const;
+      Bits               shiftRightArithmetic (size_t) const;
+      Bits               shiftRightArithmetic (const Bits&) const;
+      Bit                lessSigned           (const Bits&) const;
+      Bit                lessEqualSigned      (const Bits&) const;
+      Bit                greaterSigned        (const Bits&) const;
+      Bit                greaterEqualSigned   (const Bits&) const;
+
       void               assertAll () const;
       void               assertAny () const;
       Bit                all       () const;
       Bit                any       () const;
       Bit                none      () const;
-      Bit                atmost    (unsigned int) const;
-      Bit                exactly   (unsigned int) const;
+      Bit                atmost    (unsigned int, CardinalityEncoding =
+                                                  CardinalityEncoding::Auto) const;
+      Bit                exactly   (unsigned int, CardinalityEncoding =
+                                                  CardinalityEncoding::Auto) const;
 
       const std::vector <Bit>&          vector () const;
       std::vector <Bit>::iterator       begin  ();
@@ -89,15 +279,87 @@ namespace cppsat {
   Bit  all             (const std::vector <Bit>&);
   Bit  any             (const std::vector <Bit>&);
   Bit  none            (const std::vector <Bit>&);
-  Bit  atmost          (unsigned int, const std::vector <Bit>&);
-  Bit  exactly         (unsigned int, const std::vector <Bit>&);
+  Bit  atmost          (unsigned int, const std::vector <Bit>&,
+                        CardinalityEncoding = CardinalityEncoding::Auto);
+  Bit  exactly         (unsigned int, const std::vector <Bit>&,
+                        CardinalityEncoding = CardinalityEncoding::Auto);
   Bit  allEqual        (const std::vector <Bits>&);
-  Bit  allDifferent    (const std::vector <Bits>&);
+  Bit  allDifferent    (const std::vector <Bits>&,
+                        AllDifferentEncoding = AllDifferentEncoding::Auto);
+
+  // Pseudo-Boolean constraints compare the sum of the weights of the true
+  // bits to a bound.  Weights may be negative, terms over the same bit are
+  // merged and terms over constants are folded into the bound.
+  Bit  pbLeq           (const std::vector <long>&, const std::vector <Bit>&, long,
+                        PseudoBooleanEncoding = PseudoBooleanEncoding::Auto);
+  Bit  pbGeq           (const std::vector <long>&, const std::vector <Bit>&, long,
+                        PseudoBooleanEncoding = PseudoBooleanEncoding::Auto);
+  Bit  pbEq            (const std::vector <long>&, const std::vector <Bit>&, long,
+                        PseudoBooleanEncoding = PseudoBooleanEncoding::Auto);
 
   bool solve           ();
   bool solve           (Bit);
+  bool solve           (const std::vector <Bit>&);
+  bool solvePortfolio  (unsigned int = 0, const std::vector <Bit>& = std::vector <Bit> ());
+
+  // solveCubes splits on at most 20 bits and ignores further ones
+  bool solveCubes      (const std::vector <Bit>&, unsigned int = 0);
+  bool solveCubes      (unsigned int, unsigned int = 0);
+
+  void push            ();
+  void pop             ();
   void reset           ();
+  void setEncoding     (Encoding);
+
+  const std::vector <Bit>& core ();
+
+  // solveAsync runs solveLimited in another thread, during which the context
+  // must not be used otherwise
+  Result               solveLimited (const Budget&, const std::vector <Bit>& = std::vector <Bit> ());
+  std::future <Result> solveAsync   (const Budget& = Budget (),
+                                     const std::vector <Bit>& = std::vector <Bit> ());
+
+  // simplify runs the backend's preprocessing.  Afterwards only the given
+  // bits, the named bits and bits created later may be used to build new
+  // constraints, while all bits keep their values in models.
+  void simplify (const std::vector <Bits>& = std::vector <Bits> ());
+
+  bool minimize (const Bits&, OptimizationStrategy = OptimizationStrategy::Linear);
+  bool maximize (const Bits&, OptimizationStrategy = OptimizationStrategy::Linear);
+
+  size_t enumerate (const Bits&, const std::function <bool (const std::vector <bool>&)>&,
+                    size_t = 0);
   void printStatistics ();
+  void instrument      (bool);
+
+  Statistics statistics ();
+
+  // logClauses makes the current context keep a copy of its clauses, which
+  // solvePortfolio and solveCubes need to load further solvers and
+  // writeDimacs and writeSnapshot need to write them.  It fails once the
+  // context has emitted clauses.  Without the copy, solvePortfolio and
+  // solveCubes solve with the context's solver alone and writeDimacs and
+  // writeSnapshot return false.
+  bool logClauses      ();
+
+  // writeDimacs streams all clauses of the current context, including the
+  // ones emitted later, until closeDimacs, which also appends the names
+  // given by name as comments.  Streams that cannot seek, such as pipes,
+  // only get the clauses emitted before writeDimacs, so that the header
+  // stays right.  readDimacs returns the file's variables.
+  void name            (const Bit&, const std::string&);
+  void name            (const Bits&, const std::string&);
+  bool writeDimacs     (std::ostream&);
+  void closeDimacs     ();
+  Bits readDimacs      (const std::string&);
+
+  // writeSnapshot stores the variables, clauses, gate cache and names of the
+  // current context in one binary block, which readSnapshot maps and adds to
+  // the current context.  Both fail while scopes are open.  named returns
+  // the bits last given a name.
+  bool writeSnapshot   (std::ostream&);
+  bool readSnapshot    (const std::string&);
+  Bits named           (const std::string&);
 
   template <typename It, typename F>
   Bit forall (It first, It last, F f) {
@@ -118,6 +380,29 @@ namespace cppsat {
   }
 }
 
+namespace std {
+  template <>
+  struct hash <cppsat::Bit> {
+    size_t operator() (const cppsat::Bit& bit) const {
+      return std::hash <int> () (bit._literal);
+    }
+  };
+
+  template <>
+  struct less <cppsat::Bit> {
+    bool operator() (const cppsat::Bit& a, const cppsat::Bit& b) const {
+      return a._literal < b._literal;
+    }
+  };
+
+  template <>
+  struct equal_to <cppsat::Bit> {
+    bool operator() (const cppsat::Bit& a, const cppsat::Bit& b) const {
+      return a._literal == b._literal;
+    }
+  };
+}
+
 std::ostream& operator<<(std::ostream&, const cppsat::Bit&);
 std::ostream& operator<<(std::ostream&, const cppsat::Bits&);
 
@@ -0,0 +1,309 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../cppsat.hpp"
+
+using cppsat::Bit;
+using cppsat::Bits;
+
+// Runs parameterized problem families and prints one JSON object per run:
+//
+//   benchmark                       all families at their default sizes
+//   benchmark <family>              one family at its default sizes
+//   benchmark <family> <size>...    one family at the given sizes
+//
+// Every run may solve for at most `secondsPerRun`, after which its result is
+// "unknown".  A run that does not exit normally, e.g. because of a failed
+// assertion, has the result "crashed" and makes the program exit with 1.
+
+typedef std::function <void (unsigned int)> Encoder;
+
+const double secondsPerRun = 60;
+
+struct Family {
+  std::vector <unsigned int> sizes;
+  Encoder                    encode;
+};
+
+double secondsSince (std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration <double> (std::chrono::steady_clock::now () - start).count ();
+}
+
+long peakRssKiB () {
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+Bits constant (size_t width, uint64_t value) {
+  std::vector <bool> bits;
+  for (size_t i = 0; i < width; i++) {
+    bits.push_back (i < 64 && ((value >> i) & 1));
+  }
+  return Bits (bits);
+}
+
+const char* resultName (cppsat::Result result) {
+  switch (result) {
+    case cppsat::Result::Sat:   return "sat";
+    case cppsat::Result::Unsat: return "unsat";
+    default:                    return "unknown";
+  }
+}
+
+// Every run gets its own forked process, so that runs neither share
+// variables nor report the peak resident set size of an earlier run
+void measure (const std::string& name, unsigned int size, const Encoder& encode) {
+  cppsat::Context      context;
+  cppsat::ContextScope scope (context);
+
+  const auto   encodeStart = std::chrono::steady_clock::now ();
+  encode (size);
+  const double encodeTime = secondsSince (encodeStart);
+
+  cppsat::Budget budget;
+  budget.seconds = secondsPerRun;
+
+  const auto           solveStart = std::chrono::steady_clock::now ();
+  const cppsat::Result result     = cppsat::solveLimited (budget);
+  const double         solveTime  = secondsSince (solveStart);
+
+  const cppsat::Statistics statistics = cppsat::statistics ();
+
+  std::cout << "{\"family\": \""      << name                 << "\""
+            << ", \"size\": "          << size
+            << ", \"result\": \""      << resultName (result) << "\""
+            << ", \"encodeSeconds\": " << encodeTime
+            << ", \"solveSeconds\": "  << solveTime
+            << ", \"variables\": "     << statistics.variables
+            << ", \"clauses\": "       << statistics.clauses
+            << ", \"literals\": "      << statistics.literals
+            << ", \"conflicts\": "     << statistics.conflicts
+            << ", \"peakRssKiB\": "    << peakRssKiB ()
+            << "}" << std::endl;
+}
+
+bool run (const std::string& name, unsigned int size, const Encoder& encode) {
+  std::cout.flush ();
+
+  const pid_t child = fork ();
+  if (child == 0) {
+    measure (name, size, encode);
+    _exit (0);
+  }
+
+  int status = 0;
+  if (child < 0 || waitpid (child, &status, 0) != child) {
+    std::cerr << "cannot run " << name << " " << size << std::endl;
+    return false;
+  }
+  else if (WIFEXITED (status) && WEXITSTATUS (status) == 0) {
+    return true;
+  }
+  else {
+    std::cout << "{\"family\": \"" << name << "\""
+              << ", \"size\": "     << size
+              << ", \"result\": \"crashed\"";
+    if (WIFSIGNALED (status)) {
+      std::cout << ", \"signal\": " << WTERMSIG (status);
+    }
+    else {
+      std::cout << ", \"exitStatus\": " << WEXITSTATUS (status);
+    }
+    std::cout << "}" << std::endl;
+    return false;
+  }
+}
+
+void queens (unsigned int n) {
+  std::vector <Bits> board;
+  for (unsigned int r = 0; r < n; r++) {
+    board.push_back (Bits (n));
+  }
+
+  for (unsigned int r = 0; r < n; r++) {
+    cppsat::assertAll ({ board[r].exactly (1) });
+  }
+  for (unsigned int c = 0; c < n; c++) {
+    Bits column;
+    for (unsigned int r = 0; r < n; r++) {
+      column.add (board[r][c]);
+    }
+    cppsat::assertAll ({ column.exactly (1) });
+  }
+  for (int c = - int (n) + 1; c < int (n); c++) {
+    Bits diagonal, antiDiagonal;
+    for (int r = 0; r < int (n); r++) {
+      if (c + r >= 0 && c + r < int (n)) {
+        diagonal    .add (board[r][c + r]);
+        antiDiagonal.add (board[n - r - 1][c + r]);
+      }
+    }
+    cppsat::assertAll ({ diagonal    .atmost (1) });
+    cppsat::assertAll ({ antiDiagonal.atmost (1) });
+  }
+}
+
+// An empty k^2 x k^2 sudoku
+void sudoku (unsigned int k) {
+  const unsigned int n     = k * k;
+  size_t             width = 1;
+  while ((1u << width) <= n) {
+    width++;
+  }
+
+  std::vector <std::vector <Bits>> board (n);
+  for (unsigned int i = 0; i < n; i++) {
+    for (unsigned int j = 0; j < n; j++) {
+      Bits number (width);
+      cppsat::assertAll ({ number >= Bits (width, 1), number <= Bits (width, n) });
+      board[i].push_back (number);
+    }
+  }
+  for (unsigned int i = 0; i < n; i++) {
+    std::vector <Bits> column;
+    for (unsigned int j = 0; j < n; j++) {
+      column.push_back (board[j][i]);
+    }
+    cppsat::assertAll ({ cppsat::allDifferent (board[i]) });
+    cppsat::assertAll ({ cppsat::allDifferent (column) });
+  }
+  for (unsigned int i = 0; i < k; i++) {
+    for (unsigned int j = 0; j < k; j++) {
+      std::vector <Bits> block;
+      for (unsigned int u = 0; u < k; u++) {
+        for (unsigned int v = 0; v < k; v++) {
+          block.push_back (board[k*i + u][k*j + v]);
+        }
+      }
+      cppsat::assertAll ({ cppsat::allDifferent (block) });
+    }
+  }
+}
+
+uint64_t largestPrimeBelow (uint64_t n) {
+  for (uint64_t p = n - 1; p > 2; p--) {
+    bool isPrime = p % 2 == 1;
+    for (uint64_t d = 3; isPrime && d * d <= p; d += 2) {
+      isPrime = p % d != 0;
+    }
+    if (isPrime) {
+      return p;
+    }
+  }
+  return 2;
+}
+
+// Factors the product of the two largest primes of width/2 bits
+void factoring (unsigned int width) {
+  const unsigned int half = width / 2;
+  const uint64_t     p    = largestPrimeBelow (uint64_t (1) << half);
+  const uint64_t     q    = largestPrimeBelow (p);
+
+  Bits a (half);
+  Bits b (half);
+
+  cppsat::assertAll ( { a.multiplyFull (b) == constant (2 * half, p * q)
+                      , a > Bits (half, 1)
+                      , b > Bits (half, 1)
+                      } );
+}
+
+void adder (unsigned int width) {
+  Bits a (width);
+  Bits b (width);
+
+  cppsat::assertAll ( { a + b == constant (width, 0x9e3779b97f4a7c15ull)
+                      , a > b
+                      } );
+}
+
+void cardinality (unsigned int n) {
+  Bits bits (n);
+
+  for (cppsat::CardinalityEncoding e : { cppsat::CardinalityEncoding::SequentialCounter
+                                       , cppsat::CardinalityEncoding::Totalizer
+                                       , cppsat::CardinalityEncoding::SortingNetwork
+                                       })
+  {
+    cppsat::assertAll ({ bits.atmost (n / 3, e) });
+  }
+  cppsat::assertAll ({ bits.exactly (n / 4) });
+}
+
+// n items with pseudo-random weights and values, of which a selection
+// within half of the total weight reaches half of the total value
+void knapsack (unsigned int n) {
+  std::vector <long> weights, values;
+  uint64_t           state = 0x9e3779b97f4a7c15ull;
+  long               totalWeight = 0, totalValue = 0;
+
+  for (unsigned int i = 0; i < n; i++) {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    weights.push_back (long ((state >> 33) % 1000) + 1);
+    values .push_back (long ((state >> 43) % 1000) + 1);
+    totalWeight += weights.back ();
+    totalValue  += values .back ();
+  }
+
+  const Bits items (n);
+  cppsat::assertAll ( { cppsat::pbLeq (weights, items.vector (), totalWeight / 2)
+                      , cppsat::pbGeq (values , items.vector (), totalValue  / 2)
+                      } );
+}
+
+int main (int argc, char** argv) {
+  const std::map <std::string, Family> families =
+    { { "queens"     , { { 8, 16, 32, 64, 100, 200 }, queens      } }
+    , { "sudoku"     , { { 2, 3, 4, 5 }             , sudoku      } }
+    , { "factoring"  , { { 8, 16, 24, 32, 48, 64 }  , factoring   } }
+    , { "adder"      , { { 8, 64, 256, 1024 }       , adder       } }
+    , { "cardinality", { { 100, 400, 1000 }         , cardinality } }
+    , { "knapsack"   , { { 20, 50, 100, 200 }       , knapsack    } }
+    };
+
+  bool ok = true;
+
+  if (argc == 1) {
+    for (const auto& family : families) {
+      for (unsigned int size : family.second.sizes) {
+        ok = run (family.first, size, family.second.encode) && ok;
+      }
+    }
+    return ok ? 0 : 1;
+  }
+
+  const auto family = families.find (argv[1]);
+  if (family == families.end ()) {
+    std::cerr << "unknown family: " << argv[1] << std::endl;
+    return 1;
+  }
+
+  std::vector <unsigned int> sizes;
+  for (int i = 2; i < argc; i++) {
+    char*               end  = nullptr;
+    const unsigned long size = std::strtoul (argv[i], &end, 10);
+
+    // a positive decimal number without sign or leading zeros
+    if (*argv[i] < '1' || *argv[i] > '9' || *end != '\0' || size > 1000000) {
+      std::cerr << "invalid size: " << argv[i] << std::endl;
+      return 1;
+    }
+    sizes.push_back (unsigned (size));
+  }
+  if (sizes.empty ()) {
+    sizes = family->second.sizes;
+  }
+  for (unsigned int size : sizes) {
+    ok = run (family->first, size, family->second.encode) && ok;
+  }
+  return ok ? 0 : 1;
+}